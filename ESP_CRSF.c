@@ -1,180 +1,757 @@
 #include <stdio.h>
 #include "ESP_CRSF.h"
 #include "byteswap.h"
+#include "crsf_frame.h"
+#include "crsf_rate.h"
+#include "crsf_internal.h"
+#include "crsf_uart.h"
+#include "crsf_sbus.h"
+#include "crsf_ppm.h"
+#include "crsf_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "freertos/timers.h"
 
 
-#define RX_BUF_SIZE 1024 // UART buffer size
+#if CONFIG_CRSF_MINIMAL_FOOTPRINT
+#define RX_BUF_SIZE CRSF_MAX_FRAME_SIZE // rx_task read buffer, frames are reassembled by the parser anyway
+#else
+#define RX_BUF_SIZE CONFIG_CRSF_RX_BUF_SIZE // rx_task read buffer
+#endif
 
-// CRC8 lookup table (poly 0xd5)
-static uint8_t crc8_table[256] = {0};
+#define FAILSAFE_AUTO_MAX_MS 60000 // cap of the derived failsafe timeout, keeps pdMS_TO_TICKS in range
 
-void generate_CRC(uint8_t poly)
+SemaphoreHandle_t xMutex;
+
+static crsf_config_t crsf_config;
+crsf_channels_t received_channels = {0};
+crsf_battery_t received_battery = {0};
+crsf_link_statistics_t received_link_statistics = {0};
+
+static bool failsafe_flag = true; // Failsafe flag
+static TimerHandle_t failsafe_timer = NULL; // Watchdog timer
+
+static crsf_parser_t rx_parser;
+#if CONFIG_CRSF_INPUT_SBUS
+static crsf_sbus_parser_t sbus_parser;
+#endif
+static crsf_rate_estimator_t rate_estimator;
+// missed frames << 16 | minimum timeout in ms, one word so rx_task never sees half an update;
+// 0 missed frames: fixed CONFIG_CRSF_FAILSAFE_TIMEOUT_MS
+static uint32_t failsafe_auto = 0;
+static TaskHandle_t rx_task_handle = NULL;
+static volatile bool rx_task_stop = false;
+static SemaphoreHandle_t rx_task_exited = NULL;
+
+typedef struct
 {
-  for (int idx = 0; idx < 256; ++idx)
-  {
-    uint8_t crc = idx;
-    for (int shift = 0; shift < 8; ++shift)
-    {
-      crc = (crc << 1) ^ ((crc & 0x80) ? poly : 0);
+    TaskHandle_t task;
+    uint32_t events;
+} crsf_subscriber_t;
+
+static crsf_subscriber_t subscribers[CRSF_MAX_SUBSCRIBERS];
+static portMUX_TYPE subscribers_lock = portMUX_INITIALIZER_UNLOCKED;
+
+const crsf_config_t *crsf_get_config(void)
+{
+    return &crsf_config;
+}
+
+TaskHandle_t crsf_get_rx_task(void)
+{
+    return rx_task_handle;
+}
+
+const crsf_parser_t *crsf_get_rx_parser(void)
+{
+    return &rx_parser;
+}
+
+static CRSF_IRAM_ATTR void notify_subscribers(uint32_t events)
+{
+    crsf_subscriber_t targets[CRSF_MAX_SUBSCRIBERS];
+
+    // notify outside the critical section, xTaskNotify may switch tasks
+    portENTER_CRITICAL(&subscribers_lock);
+    memcpy(targets, subscribers, sizeof(targets));
+    portEXIT_CRITICAL(&subscribers_lock);
+
+    for (int i = 0; i < CRSF_MAX_SUBSCRIBERS; i++) {
+        if (targets[i].task != NULL && (targets[i].events & events)) {
+            xTaskNotify(targets[i].task, targets[i].events & events, eSetBits);
+        }
     }
-    crc8_table[idx] = crc & 0xff;
-  }
 }
 
-// Function to calculate CRC8 checksum
-uint8_t crc8(const uint8_t *data, uint8_t len)
+// add events to the subscription of a task, replace the mask if replace is set
+static esp_err_t subscribe_task(TaskHandle_t task, uint32_t events, bool replace)
 {
-  uint8_t crc = 0;
-  while (len--)
-  {
-    crc = crc8_table[crc ^ *data++];
-  }
+    esp_err_t err = ESP_ERR_NO_MEM;
+    int free_slot = -1;
+
+    portENTER_CRITICAL(&subscribers_lock);
+    for (int i = 0; i < CRSF_MAX_SUBSCRIBERS; i++) {
+        if (subscribers[i].task == task) {
+            subscribers[i].events = replace ? events : subscribers[i].events | events;
+            err = ESP_OK;
+            break;
+        }
+        if (subscribers[i].task == NULL && free_slot < 0) {
+            free_slot = i;
+        }
+    }
+    if (err != ESP_OK && free_slot >= 0) {
+        subscribers[free_slot].task = task;
+        subscribers[free_slot].events = events;
+        err = ESP_OK;
+    }
+    portEXIT_CRITICAL(&subscribers_lock);
 
-  return crc;
+    return err;
 }
 
-SemaphoreHandle_t xMutex;
+// called whenever the rate estimate changes or auto mode is reconfigured
+static void apply_failsafe_timeout(uint32_t interval_us)
+{
+    uint32_t timeout_ms = CONFIG_CRSF_FAILSAFE_TIMEOUT_MS;
+    uint32_t setting = __atomic_load_n(&failsafe_auto, __ATOMIC_RELAXED);
+    uint16_t failsafe_auto_frames = setting >> 16;
+    uint16_t failsafe_auto_min_ms = setting & 0xFFFF;
+
+    if (failsafe_auto_frames > 0 && interval_us > 0) {
+        // 65535 frames of a slow estimate overflow 32 bits
+        uint64_t auto_ms = ((uint64_t)failsafe_auto_frames * interval_us + 999) / 1000;
+        timeout_ms = auto_ms < FAILSAFE_AUTO_MAX_MS ? (uint32_t)auto_ms : FAILSAFE_AUTO_MAX_MS;
+        if (timeout_ms < failsafe_auto_min_ms) {
+            timeout_ms = failsafe_auto_min_ms;
+        }
+    }
+    if (failsafe_timer != NULL) {
+        xTimerChangePeriod(failsafe_timer, pdMS_TO_TICKS(timeout_ms) > 0 ? pdMS_TO_TICKS(timeout_ms) : 1, 0);
+    }
+}
 
-static int uart_num = 1;
-static QueueHandle_t uart_queue;
-crsf_channels_t received_channels = {0};
-crsf_battery_t received_battery = {0};
-crsf_link_statistics_t received_link_statistics = {0};
+#if CONFIG_CRSF_RX_CHANNELS
+// common channel state update of all inputs, payload is packed like CRSF_TYPE_CHANNELS
+static CRSF_IRAM_ATTR void publish_channels(const uint8_t *payload, int64_t arrival_us)
+{
+  uint32_t events = CRSF_EVENT_CHANNELS;
 
-static bool failsafe_flag = true; // Failsafe flag
-static TimerHandle_t failsafe_timer = NULL; // Watchdog timer
+  xSemaphoreTake(xMutex, portMAX_DELAY);
+  memcpy(&received_channels, payload, sizeof(crsf_channels_t));
+  bool rate_changed = crsf_rate_update(&rate_estimator, arrival_us);
+  xSemaphoreGive(xMutex);
+  crsf_history_push(payload, arrival_us);
 
-static void rx_task(void *arg)
+  if (rate_changed) {
+      apply_failsafe_timeout(crsf_rate_interval_us(&rate_estimator));
+      events |= CRSF_EVENT_RATE_CHANGED;
+  }
+
+  // Reset the failsafe timer
+  if (failsafe_timer != NULL) {
+      xTimerReset(failsafe_timer, 0);
+  }
+
+  // Clear the failsafe flag
+  if (failsafe_flag) {
+      events |= CRSF_EVENT_FAILSAFE;
+  }
+  failsafe_flag = false;
+
+  // outputs first, they are the latency-critical consumer when enabled
+  if (crsf_output_active) {
+      crsf_output_channels(payload, arrival_us);
+  }
+
+  notify_subscribers(events);
+
+  if (crsf_latency_active) {
+      crsf_latency_channels_published(payload, arrival_us);
+  }
+  if (crsf_low_power_active) {
+      crsf_low_power_frame(arrival_us, crsf_rate_interval_us(&rate_estimator));
+  }
+  // the receiver takes telemetry right after it sent channels, SBUS and PPM have no downlink
+  if (crsf_sensor_active && crsf_config.input == CRSF_INPUT_CRSF) {
+      crsf_sensor_slot(esp_timer_get_time());
+  }
+}
+#endif
+
+// common failsafe entry of the timer, the inputs and CRSF_deinit
+static void enter_failsafe(void)
+{
+    bool was_failsafe = failsafe_flag;
+    failsafe_flag = true; // Set the failsafe flag
+    if (!was_failsafe) {
+        if (crsf_output_active) {
+            crsf_output_failsafe();
+        }
+        notify_subscribers(CRSF_EVENT_FAILSAFE);
+    }
+}
+
+static CRSF_IRAM_ATTR void handle_frame(const crsf_frame_t *frame, void *ctx)
 {
-  uart_event_t event;
-  uint8_t *dtmp = (uint8_t *)malloc(RX_BUF_SIZE);
-  for (;;)
+  switch (frame->type)
   {
-    // Waiting for UART event.
-    if (xQueueReceive(uart_queue, (void *)&event, (TickType_t)portMAX_DELAY))
-    {
-      bzero(dtmp, RX_BUF_SIZE);
-      if (event.type == UART_DATA)
+#if CONFIG_CRSF_RX_CHANNELS
+    case CRSF_TYPE_CHANNELS:
+      if (frame->payload_length < sizeof(crsf_channels_t))
       {
-        // ESP_LOGI(TAG, "[UART DATA]: %d", event.size);
-        uart_read_bytes(uart_num, dtmp, event.size, portMAX_DELAY);
+        break;
+      }
+      publish_channels(frame->payload, esp_timer_get_time());
+      break;
+#endif
 
-        // extract length and type
-        uint8_t type = dtmp[2];
-        uint8_t length = dtmp[1];
-        uint8_t dest = dtmp[0];
+#if CONFIG_CRSF_RX_LINK_STATISTICS
+    case CRSF_TYPE_LINK_STATISTICS:
+      if (frame->payload_length < sizeof(crsf_link_statistics_t))
+      {
+        break;
+      }
+      xSemaphoreTake(xMutex, portMAX_DELAY);
+      memcpy(&received_link_statistics, frame->payload, sizeof(crsf_link_statistics_t));
+      xSemaphoreGive(xMutex);
+
+      notify_subscribers(CRSF_EVENT_LINK_STATISTICS);
+      break;
+#endif
+
+#if CONFIG_CRSF_COMMANDS
+    case CRSF_TYPE_COMMAND:
+      crsf_command_frame(frame);
+      break;
+#endif
+
+#if CONFIG_CRSF_MAVLINK
+    case CRSF_TYPE_MAVLINK_ENVELOPE:
+      crsf_mavlink_frame(frame->payload, frame->payload_length);
+      break;
+#endif
+
+#if CONFIG_CRSF_SELFTEST
+    case CRSF_SELFTEST_TYPE:
+      crsf_selftest_frame(frame->payload, frame->payload_length);
+      break;
+#endif
+  }
+}
 
-        // read the rest of the frame
-        uint8_t payload_length = length - 2;
-        uint8_t payload[payload_length];
+#if CONFIG_CRSF_INPUT_SBUS
+static CRSF_IRAM_ATTR void handle_sbus_frame(const uint8_t *payload, uint8_t flags, void *ctx)
+{
+  // receivers keep sending their failsafe values after the link is lost, those are not channels
+  if (flags & CRSF_SBUS_FLAG_FAILSAFE)
+  {
+    enter_failsafe();
+    return;
+  }
+  publish_channels(payload, esp_timer_get_time());
+}
+#endif
 
-        for (int i = 0; i < payload_length; i++)
-        {
-          payload[i] = dtmp[i + 3];
-        }
+#if CONFIG_CRSF_INPUT_PPM
+static void ppm_rx_loop(void)
+{
+  uint16_t values[16];
+  uint8_t payload[CRSF_CHANNELS_PAYLOAD_SIZE];
+  int64_t arrival_us;
 
- 
-        switch (type)
-        {
-          case CRSF_TYPE_CHANNELS:
-            xSemaphoreTake(xMutex, portMAX_DELAY);
-            received_channels = *(crsf_channels_t *)payload;
-            xSemaphoreGive(xMutex);
-
-            // Reset the failsafe timer
-            if (failsafe_timer != NULL) {
-                xTimerReset(failsafe_timer, 0);
-            }
+  while (!rx_task_stop)
+  {
+    if (crsf_ppm_receive(values, &arrival_us) > 0)
+    {
+      crsf_pack_channels(values, payload);
+      publish_channels(payload, arrival_us);
+    }
+  }
+}
+#endif
 
-            // Clear the failsafe flag
-            failsafe_flag = false;
+static void rx_task(void *arg)
+{
+#if CONFIG_CRSF_INPUT_SBUS || CONFIG_CRSF_INPUT_PPM
+  crsf_input_t input = (crsf_input_t)(intptr_t)arg;
+#endif
 
-            break;
+#if CONFIG_CRSF_INPUT_PPM
+  if (input == CRSF_INPUT_PPM)
+  {
+    ppm_rx_loop();
+    xSemaphoreGive(rx_task_exited);
+    vTaskDelete(NULL);
+  }
+#endif
 
-          case CRSF_TYPE_LINK_STATISTICS:
-            xSemaphoreTake(xMutex, portMAX_DELAY);
-            received_link_statistics = *(crsf_link_statistics_t *)payload;
-            xSemaphoreGive(xMutex);
-            break;
-        }
+  // internal RAM, never PSRAM, so parsing does not depend on the cache
+  uint8_t *dtmp = (uint8_t *)heap_caps_malloc(RX_BUF_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  while (!rx_task_stop)
+  {
+    // Waiting for UART data.
+    int len = crsf_uart_receive(dtmp, RX_BUF_SIZE);
+
+    // frames may be split across or packed into reads, the parser reassembles them
+    if (len > 0)
+    {
+#if CONFIG_CRSF_INPUT_SBUS
+      if (input == CRSF_INPUT_SBUS)
+      {
+        crsf_sbus_parser_feed(&sbus_parser, dtmp, len, handle_sbus_frame, NULL);
+        continue;
+      }
+#endif
+      crsf_parser_feed(&rx_parser, dtmp, len, handle_frame, NULL);
+
+      if (crsf_latency_active)
+      {
+        crsf_latency_rx_done();
       }
     }
+    else if (len < 0)
+    {
+      rx_parser.pos = 0; // drop the partial frame, keep the statistics
+#if CONFIG_CRSF_INPUT_SBUS
+      sbus_parser.pos = 0;
+#endif
+    }
   }
   free(dtmp);
   dtmp = NULL;
+  xSemaphoreGive(rx_task_exited);
   vTaskDelete(NULL);
 }
 
+static esp_err_t start_rx_task(crsf_input_t input)
+{
+    rx_task_stop = false;
+    if (xTaskCreate(rx_task, "uart_rx_task", CONFIG_CRSF_TASK_STACK_SIZE, (void *)(intptr_t)input, CONFIG_CRSF_TASK_PRIORITY, &rx_task_handle) != pdPASS) {
+        rx_task_handle = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+// resolve the defaults that depend on the input
+static void resolve_config(crsf_config_t *config)
+{
+    if (config->baud_rate == 0) {
+        config->baud_rate = config->input == CRSF_INPUT_SBUS ? CRSF_SBUS_BAUD_RATE : CRSF_BAUD_RATE;
+    }
+}
+
+// start the UART backend or the PPM input
+static esp_err_t start_input(const crsf_config_t *config)
+{
+    switch (config->input) {
+        case CRSF_INPUT_CRSF:
+            return crsf_uart_start(config);
+#if CONFIG_CRSF_INPUT_SBUS
+        case CRSF_INPUT_SBUS:
+            crsf_sbus_parser_init(&sbus_parser);
+            return crsf_uart_start(config);
+#endif
+#if CONFIG_CRSF_INPUT_PPM
+        case CRSF_INPUT_PPM:
+            return crsf_ppm_start(config->rx_pin);
+#endif
+        default:
+            return ESP_ERR_NOT_SUPPORTED;
+    }
+}
+
+// remove the UART backend or the PPM input, rx_task must not be running
+static void stop_input(crsf_input_t input)
+{
+#if CONFIG_CRSF_INPUT_PPM
+    if (input == CRSF_INPUT_PPM) {
+        crsf_ppm_stop();
+        return;
+    }
+#endif
+    crsf_uart_stop();
+    rx_parser.pos = 0;
+}
+
+// start the input and rx_task, on failure neither is left running
+static esp_err_t start_rx(const crsf_config_t *config)
+{
+    esp_err_t err = start_input(config);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = start_rx_task(config->input);
+    if (err != ESP_OK) {
+        stop_input(config->input);
+    }
+    return err;
+}
+
+// stop rx_task and remove the input, rx_task is woken from its blocking receive first
+static void stop_rx(void)
+{
+    rx_task_stop = true;
+#if CONFIG_CRSF_INPUT_PPM
+    if (crsf_config.input == CRSF_INPUT_PPM) {
+        crsf_ppm_wake();
+    } else
+#endif
+    {
+        crsf_uart_wake();
+    }
+    xSemaphoreTake(rx_task_exited, portMAX_DELAY);
+    rx_task_handle = NULL;
+
+    stop_input(crsf_config.input);
+}
+
+// release what CRSF_init set up besides the input and rx_task, and everything fed from rx_task;
+// the mutexes stay, getters may still run
+static void release_component(void)
+{
+#if CONFIG_CRSF_OUTPUT
+    if (crsf_output_active) {
+        CRSF_output_stop();
+    }
+#endif
+#if CONFIG_CRSF_ESC_TELEMETRY
+    CRSF_esc_telemetry_stop();
+#endif
+    crsf_sensor_deinit();
+
+    if (failsafe_timer != NULL) {
+        xTimerDelete(failsafe_timer, portMAX_DELAY);
+        failsafe_timer = NULL;
+    }
+#if CONFIG_CRSF_COMMANDS
+    crsf_command_deinit();
+#endif
+
+    // the link is gone, consumers must not keep acting on the last channels
+    enter_failsafe();
+}
+
 // Timer callback to set the failsafe flag
 static void failsafe_timer_callback(TimerHandle_t xTimer) {
-    failsafe_flag = true; // Set the failsafe flag
+    enter_failsafe();
 }
 
 void CRSF_init(crsf_config_t *config) {
-    generate_CRC(0xd5);
-
-    uart_num = config->uart_num;
-
-    // Begin UART communication with RX
-    uart_config_t uart_config = {
-        .baud_rate = 420000,
-        .data_bits = UART_DATA_8_BITS,
-        .parity = UART_PARITY_DISABLE,
-        .stop_bits = UART_STOP_BITS_1,
-        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE
-    };
-    uart_param_config(config->uart_num, &uart_config);
-    uart_set_pin(uart_num, config->tx_pin, config->rx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
-    ESP_ERROR_CHECK(uart_driver_install(uart_num, RX_BUF_SIZE, RX_BUF_SIZE, 10, &uart_queue, 0));
+    if (rx_task_handle != NULL) {
+        ESP_LOGE("CRSF", "Already initialized, call CRSF_deinit first");
+        return;
+    }
 
-    // Create semaphore
-    xMutex = xSemaphoreCreateMutex();
+    generate_CRC(CONFIG_CRSF_CRC_POLY);
+    crsf_parser_init(&rx_parser);
+    crsf_rate_init(&rate_estimator);
+
+    crsf_config = *config;
+    resolve_config(&crsf_config);
+#if CONFIG_CRSF_MAVLINK
+    crsf_mavlink_init();
+#endif
+#if CONFIG_CRSF_COMMANDS
+    crsf_command_init();
+#endif
+
+    // Create semaphores, once: they outlive CRSF_deinit so that late getter calls stay safe
+    if (xMutex == NULL) {
+        xMutex = xSemaphoreCreateMutex();
+        rx_task_exited = xSemaphoreCreateBinary();
+    }
 
-    // Create task
-    xTaskCreate(rx_task, "uart_rx_task", 1024 * 4, NULL, configMAX_PRIORITIES - 1, NULL);
+    // Start the input and the task
+    ESP_ERROR_CHECK(start_rx(&crsf_config));
 
     // Create and start the failsafe timer
-    failsafe_timer = xTimerCreate("FailsafeTimer", pdMS_TO_TICKS(500), pdFALSE, NULL, failsafe_timer_callback);
+    failsafe_timer = xTimerCreate("FailsafeTimer", pdMS_TO_TICKS(CONFIG_CRSF_FAILSAFE_TIMEOUT_MS), pdFALSE, NULL, failsafe_timer_callback);
     if (failsafe_timer != NULL) {
         xTimerStart(failsafe_timer, 0);
     }
 }
 
+esp_err_t CRSF_deinit(void)
+{
+    if (rx_task_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+#if CONFIG_CRSF_LATENCY_MEASUREMENT
+    CRSF_latency_stop();
+#endif
+#if CONFIG_CRSF_LOW_POWER
+    CRSF_low_power_stop();
+#endif
+    stop_rx();
+    release_component();
+    return ESP_OK;
+}
+
+esp_err_t CRSF_reconfigure(const crsf_config_t *config)
+{
+    if (rx_task_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    crsf_config_t next = *config;
+    resolve_config(&next);
+
+#if CONFIG_CRSF_LATENCY_MEASUREMENT
+    if (next.uart_num != crsf_config.uart_num || next.rx_pin != crsf_config.rx_pin || next.input != CRSF_INPUT_CRSF) {
+        CRSF_latency_stop();
+    }
+#endif
+
+    esp_err_t err = ESP_OK;
+    // a UART running the same protocol is only reprogrammed, anything else restarts the input
+    if (next.uart_num == crsf_config.uart_num && next.input == crsf_config.input && next.input != CRSF_INPUT_PPM) {
+        // same driver, only the UART is reprogrammed while rx_task keeps running
+        if (next.baud_rate != crsf_config.baud_rate) {
+            crsf_uart_wait_tx_done(pdMS_TO_TICKS(10));
+            err = crsf_uart_set_baudrate(next.baud_rate);
+        }
+        if (err == ESP_OK && (next.tx_pin != crsf_config.tx_pin || next.rx_pin != crsf_config.rx_pin)) {
+            err = crsf_uart_set_pins(next.tx_pin, next.rx_pin);
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+        // bytes received at the old setting are garbage, rx_task resyncs on the next frame
+        crsf_uart_flush_input();
+    } else {
+#if CONFIG_CRSF_LOW_POWER
+        // UART wakeup is configured per port
+        CRSF_low_power_stop();
+#endif
+        stop_rx();
+        err = start_rx(&next);
+        if (err != ESP_OK) {
+            // back to the previous input so the component stays usable
+            esp_err_t fallback = start_rx(&crsf_config);
+            if (fallback != ESP_OK) {
+                // nothing runs any more, shut down completely so that CRSF_init can start again
+                ESP_LOGE("CRSF", "Previous input could not be restored, stopped");
+                release_component();
+                return fallback;
+            }
+            return err;
+        }
+    }
+
+    crsf_config = next;
+    return err;
+}
+
 // receive uart data frame
-void CRSF_receive_channels(crsf_channels_t *channels)
+CRSF_IRAM_ATTR void CRSF_receive_channels(crsf_channels_t *channels)
 {
   xSemaphoreTake(xMutex, portMAX_DELAY);
   *channels = received_channels;
   xSemaphoreGive(xMutex);
+
+  if (crsf_latency_active)
+  {
+    crsf_latency_consumer_observed();
+  }
 }
-/**
- * @brief function sends payload to a destination using uart
- *
- * @param payload pointer to payload of given crsf_type_t
- * @param destination destination for payload, typically CRSF_DEST_FC
- * @param type type of data contained in payload
- * @param payload_length length of the payload type
- */
-void CRSF_send_payload(const void *payload, crsf_dest_t destination, crsf_type_t type, uint8_t payload_length)
+
+void CRSF_get_memory_report(crsf_memory_report_t *report)
+{
+    report->rx_task_stack_size = CONFIG_CRSF_TASK_STACK_SIZE;
+    report->rx_task_stack_free_min = rx_task_handle != NULL ? uxTaskGetStackHighWaterMark(rx_task_handle) : 0;
+    report->tx_task_stack_size = crsf_config.input == CRSF_INPUT_PPM ? 0 : CRSF_UART_TX_TASK_STACK_SIZE;
+    report->rx_buffer_size = RX_BUF_SIZE;
+    report->uart_rx_ring_size = crsf_config.input == CRSF_INPUT_PPM ? 0 : CRSF_UART_RX_RING_SIZE;
+    report->uart_tx_ring_size = crsf_config.input == CRSF_INPUT_PPM ? 0 : CRSF_UART_TX_RING_SIZE;
+    report->uart_backend_size = crsf_config.input == CRSF_INPUT_PPM ? 0 : crsf_uart_memory_size();
+    report->crc_size = crsf_crc_memory_size();
+    report->core_state_size = sizeof(crsf_config) + sizeof(received_channels) + sizeof(received_battery) +
+                              sizeof(received_link_statistics) + sizeof(rx_parser) + sizeof(rate_estimator) +
+                              sizeof(subscribers);
+#if CONFIG_CRSF_INPUT_SBUS
+    report->core_state_size += sizeof(sbus_parser);
+#endif
+    report->rtos_objects_size = sizeof(StaticTask_t) + 2 * sizeof(StaticSemaphore_t) + sizeof(StaticTimer_t);
+    report->total = report->rx_task_stack_size + report->tx_task_stack_size + report->rx_buffer_size +
+                    report->uart_backend_size + report->crc_size + report->core_state_size + report->rtos_objects_size;
+}
+
+static void get_task_stack(crsf_task_stack_t *out, TaskHandle_t task, uint32_t stack_size)
+{
+    out->running = task != NULL;
+    out->stack_size = stack_size;
+    // ESP-IDF reports the high-water mark in bytes
+    out->stack_free_min = task != NULL ? uxTaskGetStackHighWaterMark(task) : 0;
+}
+
+void CRSF_get_stack_report(crsf_stack_report_t *report)
+{
+    get_task_stack(&report->rx_task, rx_task_handle, CONFIG_CRSF_TASK_STACK_SIZE);
+    get_task_stack(&report->tx_task, crsf_uart_get_tx_task(), CRSF_UART_TX_TASK_STACK_SIZE);
+    get_task_stack(&report->timer_task, xTimerGetTimerDaemonTaskHandle(), CONFIG_FREERTOS_TIMER_TASK_STACK_DEPTH);
+    get_task_stack(&report->esp_timer_task, xTaskGetHandle("esp_timer"), CONFIG_ESP_TIMER_TASK_STACK_SIZE);
+}
+
+bool CRSF_get_frame_rate(crsf_frame_rate_t *rate)
+{
+    xSemaphoreTake(xMutex, portMAX_DELAY);
+    crsf_rate_estimator_t est = rate_estimator;
+    xSemaphoreGive(xMutex);
+
+    rate->interval_us = crsf_rate_interval_us(&est);
+    rate->rate_hz = crsf_rate_hz(&est);
+    rate->jitter_us = (est.jitter_q4 + 8) >> 4;
+    rate->rate_changes = est.rate_changes;
+    rate->last_arrival_us = est.last_arrival_us;
+    return est.interval_q4 != 0;
+}
+
+void CRSF_set_failsafe_auto(uint16_t missed_frames, uint16_t min_timeout_ms)
+{
+    __atomic_store_n(&failsafe_auto, (uint32_t)missed_frames << 16 | min_timeout_ms, __ATOMIC_RELAXED);
+
+    xSemaphoreTake(xMutex, portMAX_DELAY);
+    uint32_t interval_us = crsf_rate_interval_us(&rate_estimator);
+    xSemaphoreGive(xMutex);
+
+    apply_failsafe_timeout(interval_us);
+}
+
+esp_err_t CRSF_subscribe(uint32_t events)
 {
-    // The +4 accounts for the two bytes on both ends of the packet: 2 + [payload_length] + 2
-    uint8_t packet[payload_length + 4];
+    return subscribe_task(xTaskGetCurrentTaskHandle(), events, true);
+}
+
+esp_err_t crsf_subscribe_add(uint32_t events)
+{
+    return subscribe_task(xTaskGetCurrentTaskHandle(), events, false);
+}
+
+void CRSF_unsubscribe(void)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+
+    portENTER_CRITICAL(&subscribers_lock);
+    for (int i = 0; i < CRSF_MAX_SUBSCRIBERS; i++) {
+        if (subscribers[i].task == task) {
+            subscribers[i].task = NULL;
+            subscribers[i].events = 0;
+        }
+    }
+    portEXIT_CRITICAL(&subscribers_lock);
+}
 
-    packet[0] = destination;
-    packet[1] = payload_length + 2; // Size of payload + type + CRC
-    packet[2] = type;
+uint32_t CRSF_wait_event(uint32_t events, TickType_t timeout)
+{
+    TickType_t start = xTaskGetTickCount();
+    uint32_t value = 0;
 
-    memcpy(&packet[3], payload, payload_length);
+    for (;;) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        TickType_t remaining = timeout == portMAX_DELAY ? portMAX_DELAY : (elapsed >= timeout ? 0 : timeout - elapsed);
 
-    // Calculate CRC
-    unsigned char checksum = crc8(&packet[2], payload_length + 1);
-    packet[payload_length + 3] = checksum;
+        // only the requested bits are cleared, other events stay pending for the next call
+        if (xTaskNotifyWait(0, events, &value, remaining) != pdTRUE) {
+            return 0;
+        }
+        if (value & events) {
+            return value & events;
+        }
+        if (remaining == 0) {
+            return 0;
+        }
+    }
+}
+
+bool CRSF_wait_channels(crsf_channels_t *channels, TickType_t timeout)
+{
+    if (crsf_subscribe_add(CRSF_EVENT_CHANNELS) != ESP_OK) {
+        return false;
+    }
+    if (!(CRSF_wait_event(CRSF_EVENT_CHANNELS, timeout) & CRSF_EVENT_CHANNELS)) {
+        return false;
+    }
+
+    CRSF_receive_channels(channels);
+    return true;
+}
+
+#if CONFIG_CRSF_CHANNEL_FILTER
+void CRSF_filter_init(crsf_filter_t *filter, const crsf_filter_config_t *config)
+{
+    crsf_filter_init(filter, config);
+}
+
+CRSF_IRAM_ATTR void CRSF_filter_channels(crsf_filter_t *filter, uint16_t *values)
+{
+    crsf_channels_t channels;
+
+    xSemaphoreTake(xMutex, portMAX_DELAY);
+    channels = received_channels;
+    int64_t arrival_us = rate_estimator.last_arrival_us;
+    uint32_t interval_us = crsf_rate_interval_us(&rate_estimator);
+    xSemaphoreGive(xMutex);
+
+    crsf_filter_set_interval(filter, interval_us);
+    if (arrival_us != 0 && arrival_us != filter->frame_us) {
+        uint16_t latest[CRSF_FILTER_CHANNELS];
+        crsf_unpack_channels((const uint8_t *)&channels, latest);
+        crsf_filter_input(filter, latest, arrival_us);
+    }
+    crsf_filter_output(filter, esp_timer_get_time(), values);
+}
+#endif
+
+void CRSF_send_payload(const void *payload, crsf_dest_t destination, crsf_type_t type, uint8_t payload_length)
+{
+    // fixed size, crsf_build_frame rejects payloads that do not fit before writing
+    uint8_t packet[CRSF_MAX_FRAME_SIZE];
 
+    size_t packet_length = crsf_build_frame(packet, destination, type, payload, payload_length);
+    if (packet_length == 0) {
+        ESP_LOGE("CRSF", "Payload of %u bytes does not fit in a frame", payload_length);
+        return;
+    }
     // Send frame
-    uart_write_bytes(uart_num, packet, payload_length + 4);
+    crsf_send_telemetry(packet, packet_length, type);
+}
+
+bool crsf_send_telemetry(const uint8_t *frame, size_t length, uint8_t type)
+{
+    bool charged = crsf_budget_active;
+
+    if (charged && !crsf_budget_take(type, length)) {
+        return false;
+    }
+    if (!crsf_send_frame(frame, length)) {
+        // a frame that never went out does not use downlink bandwidth
+        if (charged) {
+            crsf_budget_refund(type, length);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool crsf_send_frame(const uint8_t *frame, size_t length)
+{
+    // SBUS and PPM have no return path
+    if (crsf_config.input != CRSF_INPUT_CRSF) {
+        return false;
+    }
+    // frames from concurrent senders stay whole, no sender writes another one's frame
+    return crsf_uart_write(frame, length);
 }
 
+void CRSF_get_tx_stats(crsf_tx_stats_t *stats)
+{
+    crsf_uart_get_tx_stats(stats);
+}
+
+#if CONFIG_CRSF_TX_BATTERY
 void CRSF_send_battery_data(crsf_dest_t dest, crsf_battery_t *payload)
 {
   crsf_battery_t *payload_proc = 0;
@@ -186,7 +763,9 @@ void CRSF_send_battery_data(crsf_dest_t dest, crsf_battery_t *payload)
 
   CRSF_send_payload(payload_proc, dest, CRSF_TYPE_BATTERY, sizeof(crsf_battery_t));
 }
+#endif
 
+#if CONFIG_CRSF_TX_GPS
 void CRSF_send_gps_data(crsf_dest_t dest, crsf_gps_t *payload)
 {
   crsf_gps_t *payload_proc = 0;
@@ -201,7 +780,18 @@ void CRSF_send_gps_data(crsf_dest_t dest, crsf_gps_t *payload)
   CRSF_send_payload(payload_proc, dest, CRSF_TYPE_GPS, sizeof(crsf_gps_t));
 }
 
-inline uint32_t bswap24(uint32_t value) {
+void CRSF_send_gps(crsf_dest_t dest, const crsf_gps_fix_t *fix)
+{
+    uint8_t frame[CRSF_MAX_FRAME_SIZE];
+
+    // encoded in place, no intermediate struct to byte swap
+    size_t length = crsf_finish_frame(frame, dest, CRSF_TYPE_GPS, crsf_encode_gps(&frame[3], fix));
+    crsf_send_telemetry(frame, length, CRSF_TYPE_GPS);
+}
+#endif
+
+#if CONFIG_CRSF_TX_RPM
+static inline uint32_t bswap24(uint32_t value) {
     // Swap only the lower 24 bits
     return ((value & 0x0000FF) << 16) | 
            ((value & 0x00FF00)) | 
@@ -215,13 +805,10 @@ void CRSF_send_rpm_values(crsf_dest_t dest, uint8_t source_id, int32_t *rpm_valu
         num_values = 19;
     }
 
-    // Allocate memory for the complete packet
+    // room for the maximum number of values, no allocation on the telemetry path
+    uint8_t buffer[sizeof(crsf_rpm_t) + 19 * sizeof(int24_t)];
+    crsf_rpm_t *rpm_packet = (crsf_rpm_t *)buffer;
     size_t packet_size = sizeof(crsf_rpm_t) + (num_values * sizeof(int24_t));
-    crsf_rpm_t *rpm_packet = malloc(packet_size);
-    if (!rpm_packet) {
-        ESP_LOGE("CRSF", "Failed to allocate memory for RPM packet");
-        return;
-    }
 
     // Set source ID
     rpm_packet->rpm_source_id = source_id;
@@ -233,24 +820,40 @@ void CRSF_send_rpm_values(crsf_dest_t dest, uint8_t source_id, int32_t *rpm_valu
 
     // Send the data
     CRSF_send_payload(rpm_packet, dest, CRSF_TYPE_RPM, packet_size);
-
-    // Clean up
-    free(rpm_packet);
 }
+#endif
 
-void CRSF_send_temp_data(crsf_dest_t dest, crsf_temp_t *payload, size_t num_temps)
+#if CONFIG_CRSF_TX_TEMP
+static void send_temp_frame(crsf_dest_t dest, uint8_t source_id, const int16_t *deci_celsius, size_t count)
 {
-    // Calculate the actual payload size
-    size_t payload_size = sizeof(uint8_t) + (num_temps * sizeof(int16_t));
+    uint8_t frame[CRSF_MAX_FRAME_SIZE];
+    size_t length = crsf_finish_frame(frame, dest, CRSF_TYPE_TEMP, crsf_encode_temp(&frame[3], source_id, deci_celsius, count));
+    crsf_send_telemetry(frame, length, CRSF_TYPE_TEMP);
+}
 
-    // Process endianness for each temperature value
-    for (size_t i = 0; i < num_temps; i++) {
-        payload->temp_value[i] = __bswap16(payload->temp_value[i]);
+void CRSF_send_temps(crsf_dest_t dest, uint8_t source_id, const int16_t *deci_celsius, size_t count)
+{
+    for (size_t first = 0; first < count; first += CRSF_TEMP_MAX_VALUES) {
+        size_t n = count - first < CRSF_TEMP_MAX_VALUES ? count - first : CRSF_TEMP_MAX_VALUES;
+        send_temp_frame(dest, source_id++, &deci_celsius[first], n);
     }
+}
 
-    // Send the data
-    CRSF_send_payload(payload, dest, CRSF_TYPE_TEMP, payload_size);
+void CRSF_send_temp_data(crsf_dest_t dest, const crsf_temp_t *payload, size_t num_temps)
+{
+    uint8_t source_id = payload->temp_source_id;
+    int16_t values[CRSF_TEMP_MAX_VALUES];
+
+    // the packed array may be unaligned, copy each frame's share out of it
+    for (size_t first = 0; first < num_temps; first += CRSF_TEMP_MAX_VALUES) {
+        size_t n = num_temps - first < CRSF_TEMP_MAX_VALUES ? num_temps - first : CRSF_TEMP_MAX_VALUES;
+        for (size_t i = 0; i < n; i++) {
+            values[i] = payload->temp_value[first + i];
+        }
+        send_temp_frame(dest, source_id++, values, n);
+    }
 }
+#endif
 
 crsf_link_statistics_t CRSF_get_link_statistics()
 {
@@ -0,0 +1,268 @@
+#include <string.h>
+#include "esp_timer.h"
+#include "crsf_internal.h"
+
+/*
+ * Telemetry rate controller. Each frame type has a token bucket in bytes.
+ * Every UPDATE_INTERVAL_US the demand of each type (bytes it tried to send,
+ * dropped ones included) is averaged and the budget is water-filled: types
+ * asking for less than their weighted share get their demand plus some room
+ * to grow, the rest is split by weight between the others. Budget left over
+ * when every type is satisfied goes to all types by weight, so a type that
+ * was idle can start sending without waiting for its demand to build up.
+ */
+
+#define UPDATE_INTERVAL_US 100000
+#define DEMAND_SHIFT 2           // demand average over about 4 update intervals
+#define BURST_US 200000          // bucket depth in time at the allocated rate
+#define DEFAULT_BYTES_PER_PACKET 5
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t weight;
+    uint32_t allowed;  // bytes per second
+    uint32_t demand;   // bytes per second
+    uint32_t attempted; // bytes since the last update
+    uint64_t tokens_q8;
+    uint32_t frames_sent;
+    uint32_t frames_dropped;
+} budget_slot_t;
+
+volatile bool crsf_budget_active = false;
+
+static portMUX_TYPE budget_lock = portMUX_INITIALIZER_UNLOCKED;
+static crsf_telemetry_budget_config_t budget_config;
+static budget_slot_t slots[CRSF_TELEMETRY_MAX_TYPES];
+static uint8_t num_slots;
+static uint32_t budget;
+static int64_t last_update_us;
+static int64_t last_refill_us;
+
+// must be called with budget_lock held
+static budget_slot_t *find_slot(uint8_t type, bool add)
+{
+    for (int i = 0; i < num_slots; i++) {
+        if (slots[i].type == type) {
+            return &slots[i];
+        }
+    }
+    if (!add || num_slots == CRSF_TELEMETRY_MAX_TYPES) {
+        return NULL;
+    }
+    budget_slot_t *slot = &slots[num_slots++];
+    memset(slot, 0, sizeof(*slot));
+    slot->type = type;
+    slot->weight = 1;
+    return slot;
+}
+
+static uint32_t compute_budget(void)
+{
+    if (budget_config.bytes_per_second != 0) {
+        return budget_config.bytes_per_second;
+    }
+
+    crsf_frame_rate_t rate;
+    // no downlink without uplink
+    if (CRSF_is_failsafe() || !CRSF_get_frame_rate(&rate)) {
+        return 0;
+    }
+    uint32_t bytes_per_packet = budget_config.bytes_per_packet ? budget_config.bytes_per_packet : DEFAULT_BYTES_PER_PACKET;
+    uint32_t bytes_per_s = rate.rate_hz * bytes_per_packet / budget_config.telemetry_ratio;
+    return bytes_per_s * (100 - budget_config.headroom_percent) / 100;
+}
+
+// must be called with budget_lock held
+static void refill(int64_t now_us)
+{
+    uint32_t elapsed_us = now_us - last_refill_us;
+    last_refill_us = now_us;
+
+    for (int i = 0; i < num_slots; i++) {
+        budget_slot_t *slot = &slots[i];
+        uint64_t burst = (uint64_t)slot->allowed * BURST_US / 1000000;
+        if (burst < CRSF_MAX_FRAME_SIZE) {
+            burst = CRSF_MAX_FRAME_SIZE; // a whole frame must fit, however small the allocation
+        }
+        slot->tokens_q8 += ((uint64_t)slot->allowed * elapsed_us << 8) / 1000000;
+        if (slot->tokens_q8 > burst << 8) {
+            slot->tokens_q8 = burst << 8;
+        }
+    }
+}
+
+// must be called with budget_lock held
+static void allocate(int64_t now_us)
+{
+    uint32_t elapsed_us = now_us - last_update_us;
+    last_update_us = now_us;
+
+    bool satisfied[CRSF_TELEMETRY_MAX_TYPES] = {0};
+    uint32_t remaining = budget;
+    uint32_t total_weight = 0;
+
+    for (int i = 0; i < num_slots; i++) {
+        budget_slot_t *slot = &slots[i];
+        int64_t sample = (uint64_t)slot->attempted * 1000000 / elapsed_us;
+        slot->demand += (sample - (int64_t)slot->demand) >> DEMAND_SHIFT;
+        slot->attempted = 0;
+        slot->allowed = 0;
+        total_weight += slot->weight;
+    }
+
+    // water-filling, every pass either satisfies a type or hands out the rest
+    uint32_t weight = total_weight;
+    bool changed = true;
+    while (changed && weight > 0) {
+        changed = false;
+        for (int i = 0; i < num_slots; i++) {
+            budget_slot_t *slot = &slots[i];
+            if (satisfied[i]) {
+                continue;
+            }
+            uint32_t share = (uint64_t)remaining * slot->weight / weight;
+            uint32_t want = slot->demand + slot->demand / 4;
+            if (want <= share) {
+                slot->allowed = want;
+                satisfied[i] = true;
+                remaining -= want;
+                weight -= slot->weight;
+                changed = true;
+            }
+        }
+    }
+    if (weight > 0) {
+        uint32_t rest = remaining;
+        for (int i = 0; i < num_slots; i++) {
+            if (!satisfied[i]) {
+                slots[i].allowed = (uint64_t)rest * slots[i].weight / weight;
+                remaining -= slots[i].allowed;
+            }
+        }
+    }
+    // spare budget goes to everyone, idle types included
+    if (remaining > 0 && total_weight > 0) {
+        uint32_t spare = remaining;
+        for (int i = 0; i < num_slots; i++) {
+            slots[i].allowed += (uint64_t)spare * slots[i].weight / total_weight;
+        }
+    }
+}
+
+bool crsf_budget_take(uint8_t type, size_t length)
+{
+    int64_t now_us = esp_timer_get_time();
+    bool update = now_us - last_update_us >= UPDATE_INTERVAL_US;
+    // CRSF_get_frame_rate takes a mutex, not allowed under the spinlock
+    uint32_t next_budget = update ? compute_budget() : 0;
+    bool allow = true;
+
+    portENTER_CRITICAL(&budget_lock);
+    if (update && now_us - last_update_us >= UPDATE_INTERVAL_US) {
+        refill(now_us);
+        budget = next_budget;
+        allocate(now_us);
+    }
+    budget_slot_t *slot = find_slot(type, true);
+    // types beyond CRSF_TELEMETRY_MAX_TYPES are not limited
+    if (slot != NULL) {
+        refill(now_us);
+        slot->attempted += length;
+        if (slot->tokens_q8 >= (uint64_t)length << 8) {
+            slot->tokens_q8 -= (uint64_t)length << 8;
+            slot->frames_sent++;
+        } else {
+            slot->frames_dropped++;
+            allow = false;
+        }
+    }
+    portEXIT_CRITICAL(&budget_lock);
+
+    return allow;
+}
+
+void crsf_budget_refund(uint8_t type, size_t length)
+{
+    portENTER_CRITICAL(&budget_lock);
+    budget_slot_t *slot = find_slot(type, false);
+    // the demand keeps the attempt, only the tokens come back
+    if (slot != NULL) {
+        slot->tokens_q8 += (uint64_t)length << 8;
+        slot->frames_sent--;
+        slot->frames_dropped++;
+    }
+    portEXIT_CRITICAL(&budget_lock);
+}
+
+esp_err_t CRSF_telemetry_budget_start(const crsf_telemetry_budget_config_t *config)
+{
+    if (config->bytes_per_second == 0 && config->telemetry_ratio == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (config->headroom_percent > 100) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    crsf_budget_active = false;
+    budget_config = *config;
+    uint32_t next_budget = compute_budget();
+    int64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&budget_lock);
+    for (int i = 0; i < num_slots; i++) {
+        slots[i].demand = 0;
+        slots[i].attempted = 0;
+        slots[i].tokens_q8 = 0;
+        slots[i].frames_sent = 0;
+        slots[i].frames_dropped = 0;
+    }
+    budget = next_budget;
+    last_update_us = now_us - UPDATE_INTERVAL_US;
+    last_refill_us = now_us;
+    allocate(now_us);
+    portEXIT_CRITICAL(&budget_lock);
+
+    crsf_budget_active = true;
+    return ESP_OK;
+}
+
+void CRSF_telemetry_budget_stop(void)
+{
+    crsf_budget_active = false;
+}
+
+esp_err_t CRSF_telemetry_set_weight(crsf_type_t type, uint8_t weight)
+{
+    if (weight == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&budget_lock);
+    budget_slot_t *slot = find_slot(type, true);
+    if (slot != NULL) {
+        slot->weight = weight;
+    }
+    portEXIT_CRITICAL(&budget_lock);
+
+    return slot != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+void CRSF_telemetry_budget_get_stats(crsf_telemetry_budget_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    portENTER_CRITICAL(&budget_lock);
+    stats->budget_bytes_per_s = budget;
+    stats->num_types = num_slots;
+    for (int i = 0; i < num_slots; i++) {
+        crsf_telemetry_type_stats_t *out = &stats->types[i];
+        out->type = slots[i].type;
+        out->weight = slots[i].weight;
+        out->allowed_bytes_per_s = slots[i].allowed;
+        out->demand_bytes_per_s = slots[i].demand;
+        out->frames_sent = slots[i].frames_sent;
+        out->frames_dropped = slots[i].frames_dropped;
+    }
+    portEXIT_CRITICAL(&budget_lock);
+}
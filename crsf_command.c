@@ -0,0 +1,209 @@
+#include <string.h>
+#include "freertos/timers.h"
+#include "crsf_frame.h"
+#include "crsf_internal.h"
+
+#define ORIGIN CRSF_DEST_FC // this side of the link
+
+/*
+ * Pending commands keep their complete frame, a retry is a single UART write
+ * from the timer service task. Acks are matched in rx_task, which runs at a
+ * higher priority and can complete a command while its retry is running, so
+ * every slot carries a generation: a retry or timeout only acts on the
+ * command it was started for, and a slot is only visible to ack matching once
+ * all its fields are written.
+ */
+typedef enum
+{
+    SLOT_FREE,
+    SLOT_FILLING, // reserved by CRSF_send_command, fields not written yet
+    SLOT_PENDING  // sent, waiting for the ack
+} slot_state_t;
+
+typedef struct
+{
+    slot_state_t state;
+    uint32_t generation;
+    uint8_t dest;
+    uint8_t command;
+    uint8_t subcommand;
+    uint8_t retries_left;
+    uint8_t frame_length;
+    uint8_t frame[CRSF_MAX_FRAME_SIZE];
+    crsf_command_callback_t callback;
+    void *ctx;
+    TimerHandle_t timer;
+} crsf_pending_command_t;
+
+static crsf_pending_command_t pending[CONFIG_CRSF_COMMAND_MAX_PENDING];
+static portMUX_TYPE pending_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// release a slot and report the result, called without pending_lock held
+static void complete(crsf_pending_command_t *cmd, uint32_t generation, crsf_command_result_t result)
+{
+    crsf_command_callback_t callback;
+    void *ctx;
+    uint8_t command, subcommand;
+
+    portENTER_CRITICAL(&pending_lock);
+    if (cmd->state != SLOT_PENDING || cmd->generation != generation) {
+        // the ack and the last timeout raced, the first one wins
+        portEXIT_CRITICAL(&pending_lock);
+        return;
+    }
+    callback = cmd->callback;
+    ctx = cmd->ctx;
+    command = cmd->command;
+    subcommand = cmd->subcommand;
+    cmd->state = SLOT_FREE;
+    portEXIT_CRITICAL(&pending_lock);
+
+    if (callback) {
+        callback(command, subcommand, result, ctx);
+    }
+}
+
+static void retry_timer_callback(TimerHandle_t timer)
+{
+    crsf_pending_command_t *cmd = pvTimerGetTimerID(timer);
+    uint8_t frame[CRSF_MAX_FRAME_SIZE];
+    uint8_t frame_length = 0;
+    uint32_t generation;
+    bool is_pending;
+
+    // the slot may be completed and reused as soon as the lock is released, resend a copy
+    portENTER_CRITICAL(&pending_lock);
+    is_pending = cmd->state == SLOT_PENDING;
+    generation = cmd->generation;
+    if (is_pending && cmd->retries_left > 0) {
+        cmd->retries_left--;
+        frame_length = cmd->frame_length;
+        memcpy(frame, cmd->frame, frame_length);
+    }
+    portEXIT_CRITICAL(&pending_lock);
+
+    if (!is_pending) {
+        return;
+    }
+    if (frame_length == 0) {
+        complete(cmd, generation, CRSF_COMMAND_TIMEOUT);
+        return;
+    }
+
+    crsf_send_frame(frame, frame_length);
+
+    portENTER_CRITICAL(&pending_lock);
+    bool still_pending = cmd->state == SLOT_PENDING && cmd->generation == generation;
+    portEXIT_CRITICAL(&pending_lock);
+    // timer commands are handled in order by this task: a command that takes the slot from
+    // here on restarts the timer itself, after this start, with its own period
+    if (still_pending) {
+        xTimerStart(timer, 0);
+    }
+}
+
+void crsf_command_init(void)
+{
+    for (int i = 0; i < CONFIG_CRSF_COMMAND_MAX_PENDING; i++) {
+        if (pending[i].timer == NULL) {
+            pending[i].timer = xTimerCreate("crsf_cmd", 1, pdFALSE, &pending[i], retry_timer_callback);
+        }
+    }
+}
+
+void crsf_command_deinit(void)
+{
+    for (int i = 0; i < CONFIG_CRSF_COMMAND_MAX_PENDING; i++) {
+        if (pending[i].timer != NULL) {
+            xTimerDelete(pending[i].timer, portMAX_DELAY);
+            pending[i].timer = NULL;
+        }
+        complete(&pending[i], pending[i].generation, CRSF_COMMAND_TIMEOUT);
+    }
+}
+
+void crsf_command_frame(const crsf_frame_t *frame)
+{
+    if (!crsf_command_valid(frame) || frame->payload[0] != ORIGIN || frame->payload[2] != CRSF_COMMAND_ACK ||
+        frame->payload_length < CRSF_COMMAND_HEADER_SIZE + sizeof(crsf_command_ack_t) + 1) {
+        return;
+    }
+
+    uint8_t origin = frame->payload[1];
+    const crsf_command_ack_t *ack = (const crsf_command_ack_t *)&frame->payload[CRSF_COMMAND_HEADER_SIZE];
+    crsf_pending_command_t *match = NULL;
+    uint32_t generation = 0;
+
+    portENTER_CRITICAL(&pending_lock);
+    for (int i = 0; i < CONFIG_CRSF_COMMAND_MAX_PENDING; i++) {
+        crsf_pending_command_t *cmd = &pending[i];
+        if (cmd->state == SLOT_PENDING && cmd->dest == origin && cmd->command == ack->command &&
+            cmd->subcommand == ack->subcommand) {
+            match = cmd;
+            generation = cmd->generation;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&pending_lock);
+
+    if (match) {
+        xTimerStop(match->timer, 0);
+        complete(match, generation, ack->action ? CRSF_COMMAND_ACCEPTED : CRSF_COMMAND_REJECTED);
+    }
+}
+
+esp_err_t CRSF_send_command(const crsf_command_request_t *request)
+{
+    crsf_pending_command_t *cmd = NULL;
+
+    if (request->payload_length > CRSF_COMMAND_MAX_PAYLOAD_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    portENTER_CRITICAL(&pending_lock);
+    for (int i = 0; i < CONFIG_CRSF_COMMAND_MAX_PENDING; i++) {
+        if (pending[i].state == SLOT_FREE && pending[i].timer != NULL) {
+            cmd = &pending[i];
+            cmd->state = SLOT_FILLING;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&pending_lock);
+
+    if (cmd == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // the slot is reserved, acks and the timer ignore it until it is pending
+    cmd->dest = request->dest;
+    cmd->command = request->command;
+    cmd->subcommand = request->subcommand;
+    cmd->retries_left = request->retries;
+    cmd->callback = request->callback;
+    cmd->ctx = request->ctx;
+    cmd->frame_length = crsf_build_command_frame(cmd->frame, request->dest, ORIGIN, request->command,
+                                                 request->subcommand, request->payload, request->payload_length);
+
+    uint16_t interval_ms = request->retry_interval_ms ? request->retry_interval_ms : CONFIG_CRSF_COMMAND_RETRY_MS;
+    TickType_t period = pdMS_TO_TICKS(interval_ms) ? pdMS_TO_TICKS(interval_ms) : 1;
+
+    // publish only now that every field is written, a late ack of an earlier command cannot match stale fields
+    portENTER_CRITICAL(&pending_lock);
+    uint32_t generation = ++cmd->generation;
+    cmd->state = SLOT_PENDING;
+    portEXIT_CRITICAL(&pending_lock);
+
+    // a frame the transmitter drops counts as a lost attempt, the retry timer sends it again
+    crsf_send_frame(cmd->frame, cmd->frame_length);
+    // changing the period also starts the timer
+    if (xTimerChangePeriod(cmd->timer, period, 0) != pdPASS) {
+        portENTER_CRITICAL(&pending_lock);
+        if (cmd->state == SLOT_PENDING && cmd->generation == generation) {
+            cmd->state = SLOT_FREE;
+        }
+        portEXIT_CRITICAL(&pending_lock);
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
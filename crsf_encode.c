@@ -0,0 +1,85 @@
+#include <math.h>
+#include "crsf_encode.h"
+
+static inline void put_be16(uint8_t *out, uint16_t value)
+{
+    out[0] = value >> 8;
+    out[1] = value;
+}
+
+static inline void put_be24(uint8_t *out, int32_t value)
+{
+    out[0] = value >> 16;
+    out[1] = value >> 8;
+    out[2] = value;
+}
+
+static inline void put_be32(uint8_t *out, uint32_t value)
+{
+    out[0] = value >> 24;
+    out[1] = value >> 16;
+    out[2] = value >> 8;
+    out[3] = value;
+}
+
+// round to nearest and saturate, NaN gives the value closest to 0 in the range
+static int32_t round_clamp(double value, int32_t min, int32_t max)
+{
+    if (isnan(value)) {
+        return min > 0 ? min : (max < 0 ? max : 0);
+    }
+    value = round(value);
+    if (value <= min) {
+        return min;
+    }
+    if (value >= max) {
+        return max;
+    }
+    return (int32_t)value;
+}
+
+size_t crsf_encode_gps(uint8_t *payload, const crsf_gps_fix_t *fix)
+{
+    // wrap before scaling so 359.999 rounds to 0 and not to 36000
+    double course = fmod(fix->course_deg, 360.0);
+    if (course < 0) {
+        course += 360.0;
+    }
+    int32_t heading = round_clamp(course * 100.0, 0, 36000);
+    if (heading == 36000) {
+        heading = 0;
+    }
+
+    put_be32(&payload[0], round_clamp(fix->latitude_deg * 1e7, -900000000, 900000000));
+    put_be32(&payload[4], round_clamp(fix->longitude_deg * 1e7, -1800000000, 1800000000));
+    put_be16(&payload[8], round_clamp(fix->ground_speed_mps * 36.0, 0, UINT16_MAX)); // 0.1 km/h
+    put_be16(&payload[10], heading);
+    put_be16(&payload[12], round_clamp(fix->altitude_m + 1000.0, 0, UINT16_MAX));
+    payload[14] = fix->satellites;
+    return CRSF_GPS_PAYLOAD_SIZE;
+}
+
+size_t crsf_encode_rpm(uint8_t *payload, uint8_t source_id, const int32_t *rpm, size_t count)
+{
+    if (count == 0 || count > CRSF_RPM_MAX_VALUES) {
+        return 0;
+    }
+    payload[0] = source_id;
+    for (size_t i = 0; i < count; i++) {
+        int32_t value = rpm[i] > 0x7FFFFF ? 0x7FFFFF : (rpm[i] < -0x800000 ? -0x800000 : rpm[i]);
+        put_be24(&payload[1 + 3 * i], value);
+    }
+    return 1 + 3 * count;
+}
+
+size_t crsf_encode_temp(uint8_t *payload, uint8_t source_id, const int16_t *deci_celsius, size_t count)
+{
+    if (count == 0 || count > CRSF_TEMP_MAX_VALUES) {
+        return 0;
+    }
+    payload[0] = source_id;
+    for (size_t i = 0; i < count; i++) {
+        put_be16(&payload[1 + 2 * i], deci_celsius[i]);
+    }
+    return 1 + 2 * count;
+}
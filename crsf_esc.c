@@ -0,0 +1,188 @@
+#include <string.h>
+#include "crsf_encode.h"
+#include "crsf_internal.h"
+
+/*
+ * ESC telemetry aggregator. DShot and BLHeli decoders store per-motor values
+ * whenever they arrive, from tasks or interrupts. Two telemetry sources, one
+ * per frame type, turn them into as few frames as possible: the motors are
+ * split into chunks of one frame each and every pull sends the next chunk
+ * holding a value that changed since it was last sent. The source rate is
+ * the per-motor rate times the number of chunks, so every motor is sent at
+ * the configured rate.
+ */
+
+typedef struct
+{
+    uint8_t per_frame;
+    uint8_t num_chunks;
+    uint8_t next_chunk;
+    uint32_t fresh; // motors updated since their chunk was last sent
+    int sensor_id;
+} esc_stream_t;
+
+_Static_assert(CONFIG_CRSF_ESC_MAX_MOTORS <= 32, "fresh masks are 32 bits");
+
+static portMUX_TYPE esc_lock = portMUX_INITIALIZER_UNLOCKED;
+static crsf_esc_telemetry_config_t esc_config;
+static int32_t rpm[CONFIG_CRSF_ESC_MAX_MOTORS];
+static int16_t temp[CONFIG_CRSF_ESC_MAX_MOTORS];
+static esc_stream_t rpm_stream = { .per_frame = CRSF_RPM_MAX_VALUES, .sensor_id = -1 };
+static esc_stream_t temp_stream = { .per_frame = CRSF_TEMP_MAX_VALUES, .sensor_id = -1 };
+static uint8_t num_motors; // 0 while stopped, updates are ignored
+
+static uint32_t chunk_mask(const esc_stream_t *stream, int chunk)
+{
+    int first = chunk * stream->per_frame;
+    int count = num_motors - first < stream->per_frame ? num_motors - first : stream->per_frame;
+    return (count == 32 ? 0xFFFFFFFFu : (1u << count) - 1) << first;
+}
+
+// must be called with esc_lock held, returns the chunk to send next or -1 if nothing changed
+static int take_chunk(esc_stream_t *stream)
+{
+    if (num_motors == 0) {
+        return -1; // stopping
+    }
+    for (int i = 0; i < stream->num_chunks; i++) {
+        int chunk = (stream->next_chunk + i) % stream->num_chunks;
+        uint32_t mask = chunk_mask(stream, chunk);
+        if (stream->fresh & mask) {
+            stream->fresh &= ~mask;
+            stream->next_chunk = (chunk + 1) % stream->num_chunks;
+            return chunk;
+        }
+    }
+    return -1;
+}
+
+static size_t fill_rpm(uint8_t *payload, size_t max_length, void *ctx)
+{
+    int32_t values[CRSF_RPM_MAX_VALUES];
+
+    portENTER_CRITICAL(&esc_lock);
+    int chunk = take_chunk(&rpm_stream);
+    int first = 0;
+    int count = 0;
+    if (chunk >= 0) {
+        first = chunk * CRSF_RPM_MAX_VALUES;
+        count = num_motors - first < CRSF_RPM_MAX_VALUES ? num_motors - first : CRSF_RPM_MAX_VALUES;
+        memcpy(values, &rpm[first], count * sizeof(values[0]));
+    }
+    portEXIT_CRITICAL(&esc_lock);
+
+    if (chunk < 0) {
+        return 0;
+    }
+    return crsf_encode_rpm(payload, esc_config.source_id + chunk, values, count);
+}
+
+static size_t fill_temp(uint8_t *payload, size_t max_length, void *ctx)
+{
+    int16_t values[CRSF_TEMP_MAX_VALUES];
+
+    portENTER_CRITICAL(&esc_lock);
+    int chunk = take_chunk(&temp_stream);
+    int first = 0;
+    int count = 0;
+    if (chunk >= 0) {
+        first = chunk * CRSF_TEMP_MAX_VALUES;
+        count = num_motors - first < CRSF_TEMP_MAX_VALUES ? num_motors - first : CRSF_TEMP_MAX_VALUES;
+        memcpy(values, &temp[first], count * sizeof(values[0]));
+    }
+    portEXIT_CRITICAL(&esc_lock);
+
+    if (chunk < 0) {
+        return 0;
+    }
+    return crsf_encode_temp(payload, esc_config.source_id + chunk, values, count);
+}
+
+static esp_err_t start_stream(esc_stream_t *stream, crsf_type_t type, uint16_t rate_hz, crsf_sensor_fill_t fill)
+{
+    stream->num_chunks = (esc_config.num_motors + stream->per_frame - 1) / stream->per_frame;
+    stream->next_chunk = 0;
+    stream->fresh = 0;
+    stream->sensor_id = -1;
+    if (rate_hz == 0) {
+        return ESP_OK;
+    }
+
+    crsf_sensor_source_t source = {
+        .type = type,
+        .dest = esc_config.dest,
+        .rate_hz = rate_hz * stream->num_chunks,
+        .fill = fill,
+    };
+    return CRSF_sensor_register(&source, &stream->sensor_id);
+}
+
+static void stop_stream(esc_stream_t *stream)
+{
+    if (stream->sensor_id >= 0) {
+        CRSF_sensor_unregister(stream->sensor_id);
+        stream->sensor_id = -1;
+    }
+}
+
+esp_err_t CRSF_esc_telemetry_start(const crsf_esc_telemetry_config_t *config)
+{
+    if (config->num_motors == 0 || config->num_motors > CONFIG_CRSF_ESC_MAX_MOTORS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (config->rpm_rate_hz == 0 && config->temp_rate_hz == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (num_motors != 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esc_config = *config;
+    memset(rpm, 0, sizeof(rpm));
+    memset(temp, 0, sizeof(temp));
+    esp_err_t err = start_stream(&rpm_stream, CRSF_TYPE_RPM, config->rpm_rate_hz, fill_rpm);
+    if (err == ESP_OK) {
+        err = start_stream(&temp_stream, CRSF_TYPE_TEMP, config->temp_rate_hz, fill_temp);
+    }
+    if (err != ESP_OK) {
+        stop_stream(&rpm_stream);
+        stop_stream(&temp_stream);
+        return err;
+    }
+
+    portENTER_CRITICAL(&esc_lock);
+    num_motors = config->num_motors;
+    portEXIT_CRITICAL(&esc_lock);
+
+    return ESP_OK;
+}
+
+void CRSF_esc_telemetry_stop(void)
+{
+    portENTER_CRITICAL(&esc_lock);
+    num_motors = 0;
+    portEXIT_CRITICAL(&esc_lock);
+
+    stop_stream(&rpm_stream);
+    stop_stream(&temp_stream);
+}
+
+void CRSF_esc_set_rpm(uint8_t motor, int32_t value)
+{
+    portENTER_CRITICAL_SAFE(&esc_lock);
+    if (motor < num_motors) {
+        rpm[motor] = value;
+        rpm_stream.fresh |= 1u << motor;
+    }
+    portEXIT_CRITICAL_SAFE(&esc_lock);
+}
+
+void CRSF_esc_set_temp(uint8_t motor, int16_t deci_celsius)
+{
+    portENTER_CRITICAL_SAFE(&esc_lock);
+    if (motor < num_motors) {
+        temp[motor] = deci_celsius;
+        temp_stream.fresh |= 1u << motor;
+    }
+    portEXIT_CRITICAL_SAFE(&esc_lock);
+}
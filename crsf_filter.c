@@ -0,0 +1,123 @@
+#include <string.h>
+#include "crsf_filter.h"
+#include "crsf_attr.h"
+
+#define TWO_PI_Q10 6434         // 2 * pi in 1/1024
+#define ALPHA_RECOMPUTE_SHIFT 3 // sample interval changes above 1/8 recompute the low-pass coefficient
+#define MAX_SAMPLE_DT_US 100000 // longer pauses of the consumer restart the low-pass from the latest frame
+
+// alpha = w / (1 + w), w = 2 pi fc dt, the discrete PT1 gain for a sample interval of dt
+static uint16_t lowpass_alpha_q15(uint16_t cutoff_hz, uint32_t dt_us)
+{
+    uint64_t w_q10 = (uint64_t)TWO_PI_Q10 * cutoff_hz * dt_us; // in 1e-6 / 1024
+    return (w_q10 << 15) / (1000000ULL * 1024 + w_q10);
+}
+
+void crsf_filter_init(crsf_filter_t *filter, const crsf_filter_config_t *config)
+{
+    memset(filter, 0, sizeof(*filter));
+    filter->config = *config;
+}
+
+void crsf_filter_set_interval(crsf_filter_t *filter, uint32_t interval_us)
+{
+    if (interval_us == filter->interval_us) {
+        return;
+    }
+    filter->interval_us = interval_us;
+    filter->inv_interval_q30 = interval_us ? (1u << 30) / interval_us : 0;
+
+    if (filter->config.cutoff_hz) {
+        filter->cutoff_hz = filter->config.cutoff_hz;
+    } else if (interval_us) {
+        filter->cutoff_hz = 1000000 / CRSF_FILTER_AUTO_CUTOFF_DIV / interval_us;
+    } else {
+        filter->cutoff_hz = 0;
+    }
+    filter->alpha_dt_us = 0; // recomputed at the next sample
+}
+
+CRSF_IRAM_ATTR void crsf_filter_input(crsf_filter_t *filter, const uint16_t *values, int64_t arrival_us)
+{
+    if (!filter->primed) {
+        memcpy(filter->prev, values, sizeof(filter->prev));
+        for (int ch = 0; ch < CRSF_FILTER_CHANNELS; ch++) {
+            filter->state_q8[ch] = (int32_t)values[ch] << 8;
+        }
+        filter->primed = true;
+    } else {
+        memcpy(filter->prev, filter->latest, sizeof(filter->prev));
+    }
+    memcpy(filter->latest, values, sizeof(filter->latest));
+    filter->frame_us = arrival_us;
+}
+
+static CRSF_IRAM_ATTR void interpolate(crsf_filter_t *filter, int64_t now_us, uint16_t *values)
+{
+    int64_t elapsed_us = now_us - filter->frame_us;
+    if (filter->interval_us == 0 || elapsed_us >= filter->interval_us) {
+        memcpy(values, filter->latest, sizeof(filter->latest));
+        return;
+    }
+
+    // fraction of the frame interval since the latest frame
+    int32_t frac_q15 = elapsed_us <= 0 ? 0 : (int32_t)(((uint64_t)elapsed_us * filter->inv_interval_q30) >> 15);
+    for (int ch = 0; ch < CRSF_FILTER_CHANNELS; ch++) {
+        int32_t step = (int32_t)filter->latest[ch] - filter->prev[ch];
+        values[ch] = filter->prev[ch] + ((step * frac_q15) >> 15);
+    }
+}
+
+static CRSF_IRAM_ATTR void lowpass(crsf_filter_t *filter, int64_t now_us, uint16_t *values)
+{
+    int64_t dt_us = now_us - filter->sample_us;
+
+    if (filter->cutoff_hz == 0 || dt_us > MAX_SAMPLE_DT_US) {
+        for (int ch = 0; ch < CRSF_FILTER_CHANNELS; ch++) {
+            filter->state_q8[ch] = (int32_t)filter->latest[ch] << 8;
+        }
+        memcpy(values, filter->latest, sizeof(filter->latest));
+        return;
+    }
+    if (filter->sample_us == 0 || dt_us <= 0) {
+        // no interval to step with yet
+        for (int ch = 0; ch < CRSF_FILTER_CHANNELS; ch++) {
+            values[ch] = (filter->state_q8[ch] + 128) >> 8;
+        }
+        return;
+    }
+
+    uint32_t diff = dt_us > filter->alpha_dt_us ? dt_us - filter->alpha_dt_us : filter->alpha_dt_us - dt_us;
+    if (filter->alpha_dt_us == 0 || diff > filter->alpha_dt_us >> ALPHA_RECOMPUTE_SHIFT) {
+        filter->alpha_q15 = lowpass_alpha_q15(filter->cutoff_hz, dt_us);
+        filter->alpha_dt_us = dt_us;
+    }
+
+    for (int ch = 0; ch < CRSF_FILTER_CHANNELS; ch++) {
+        int32_t error = ((int32_t)filter->latest[ch] << 8) - filter->state_q8[ch];
+        filter->state_q8[ch] += ((int64_t)error * filter->alpha_q15) >> 15;
+        values[ch] = (filter->state_q8[ch] + 128) >> 8;
+    }
+}
+
+CRSF_IRAM_ATTR void crsf_filter_output(crsf_filter_t *filter, int64_t now_us, uint16_t *values)
+{
+    uint16_t filtered[CRSF_FILTER_CHANNELS];
+
+    switch (filter->config.mode) {
+        case CRSF_FILTER_INTERPOLATE:
+            interpolate(filter, now_us, filtered);
+            break;
+        case CRSF_FILTER_LOWPASS:
+            lowpass(filter, now_us, filtered);
+            break;
+        default:
+            memcpy(filtered, filter->latest, sizeof(filtered));
+            break;
+    }
+    filter->sample_us = now_us;
+
+    for (int ch = 0; ch < CRSF_FILTER_CHANNELS; ch++) {
+        values[ch] = (filter->config.channel_mask & (1u << ch)) ? filtered[ch] : filter->latest[ch];
+    }
+}
@@ -0,0 +1,268 @@
+#include <string.h>
+#include "crsf_frame.h"
+#include "crsf_attr.h"
+
+#if defined(ESP_PLATFORM) && CONFIG_CRSF_CRC_BITWISE
+// polynomials only, the CRC is computed bit by bit
+static uint8_t crc8_polys[CRSF_CRC_TABLES];
+
+void crsf_crc_init(crsf_crc_t crc_table, uint8_t poly)
+{
+  crc8_polys[crc_table] = poly;
+}
+
+static CRSF_IRAM_ATTR uint8_t crc8_update(crsf_crc_t crc_table, uint8_t crc, const uint8_t *data, size_t len)
+{
+  uint8_t poly = crc8_polys[crc_table];
+  while (len--)
+  {
+    crc ^= *data++;
+    for (int shift = 0; shift < 8; ++shift)
+    {
+      crc = (crc << 1) ^ ((crc & 0x80) ? poly : 0);
+    }
+  }
+  return crc;
+}
+
+size_t crsf_crc_memory_size(void)
+{
+  return sizeof(crc8_polys);
+}
+#else
+// CRC8 lookup tables, one per polynomial (frame 0xd5, command 0xba)
+static uint8_t crc8_tables[CRSF_CRC_TABLES][256] = {0};
+
+static inline CRSF_IRAM_ATTR uint8_t crc8_update(crsf_crc_t crc_table, uint8_t crc, const uint8_t *data, size_t len)
+{
+  const uint8_t *table = crc8_tables[crc_table];
+  while (len--)
+  {
+    crc = table[crc ^ *data++];
+  }
+  return crc;
+}
+
+size_t crsf_crc_memory_size(void)
+{
+  return sizeof(crc8_tables);
+}
+
+void crsf_crc_init(crsf_crc_t crc_table, uint8_t poly)
+{
+  uint8_t *table = crc8_tables[crc_table];
+  for (int idx = 0; idx < 256; ++idx)
+  {
+    uint8_t crc = idx;
+    for (int shift = 0; shift < 8; ++shift)
+    {
+      crc = (crc << 1) ^ ((crc & 0x80) ? poly : 0);
+    }
+    table[idx] = crc & 0xff;
+  }
+}
+#endif
+
+void generate_CRC(uint8_t poly)
+{
+  crsf_crc_init(CRSF_CRC_FRAME, poly);
+  crsf_crc_init(CRSF_CRC_COMMAND, CRSF_COMMAND_CRC_POLY);
+}
+
+// Function to calculate CRC8 checksum
+CRSF_IRAM_ATTR uint8_t crc8(const uint8_t *data, uint8_t len)
+{
+  return crc8_update(CRSF_CRC_FRAME, 0, data, len);
+}
+
+uint8_t crsf_crc8(crsf_crc_t crc_table, uint8_t init, const uint8_t *data, size_t len)
+{
+  return crc8_update(crc_table, init, data, len);
+}
+
+static inline CRSF_IRAM_ATTR bool is_address(uint8_t byte)
+{
+    return byte == CRSF_DEST_FC || byte == CRSF_DEST_RADIO ||
+           byte == CRSF_DEST_RECEIVER || byte == CRSF_DEST_TRANSMITTER;
+}
+
+static inline CRSF_IRAM_ATTR bool is_length(uint8_t length)
+{
+    // length counts type + payload + CRC
+    return length >= 2 && length <= CRSF_MAX_FRAME_SIZE - 2;
+}
+
+// drop the first buffered byte and slide to the next possible frame start
+static CRSF_IRAM_ATTR void parser_resync(crsf_parser_t *parser)
+{
+    uint8_t skip = 1;
+    while (skip < parser->pos && !is_address(parser->buf[skip])) {
+        skip++;
+    }
+    parser->dropped_bytes += skip;
+    parser->pos -= skip;
+    memmove(parser->buf, parser->buf + skip, parser->pos);
+}
+
+// consume every complete frame in the buffer, leaves a valid incomplete prefix behind
+static CRSF_IRAM_ATTR size_t parser_process(crsf_parser_t *parser, crsf_frame_handler_t handler, void *ctx)
+{
+    size_t found = 0;
+
+    while (parser->pos > 0) {
+        if (!is_address(parser->buf[0])) {
+            parser_resync(parser);
+            continue;
+        }
+        if (parser->pos < 2) {
+            break;
+        }
+
+        uint8_t length = parser->buf[1];
+        if (!is_length(length)) {
+            parser_resync(parser);
+            continue;
+        }
+
+        uint8_t frame_size = length + 2;
+        if (parser->pos < frame_size) {
+            break;
+        }
+
+        if (crc8(&parser->buf[2], length - 1) != parser->buf[frame_size - 1]) {
+            parser->crc_errors++;
+            parser_resync(parser);
+            continue;
+        }
+
+        parser->frames++;
+        found++;
+        if (handler) {
+            crsf_frame_t frame = {
+                .dest = parser->buf[0],
+                .type = parser->buf[2],
+                .payload_length = length - 2,
+                .payload = &parser->buf[3]
+            };
+            handler(&frame, ctx);
+        }
+
+        parser->pos -= frame_size;
+        memmove(parser->buf, parser->buf + frame_size, parser->pos);
+    }
+
+    return found;
+}
+
+void crsf_parser_init(crsf_parser_t *parser)
+{
+    memset(parser, 0, sizeof(*parser));
+}
+
+CRSF_IRAM_ATTR size_t crsf_parser_feed(crsf_parser_t *parser, const uint8_t *data, size_t len, crsf_frame_handler_t handler, void *ctx)
+{
+    size_t found = 0;
+
+    while (len > 0) {
+        // copy up to the end of the current frame so the common case is a single memcpy per frame
+        size_t want = parser->pos < 2 ? 1 : (size_t)parser->buf[1] + 2 - parser->pos;
+        size_t n = want < len ? want : len;
+
+        memcpy(&parser->buf[parser->pos], data, n);
+        parser->pos += n;
+        data += n;
+        len -= n;
+
+        found += parser_process(parser, handler, ctx);
+    }
+
+    return found;
+}
+
+size_t crsf_finish_frame(uint8_t *frame, uint8_t dest, uint8_t type, uint8_t payload_length)
+{
+    if (payload_length > CRSF_MAX_PAYLOAD_SIZE) {
+        return 0;
+    }
+
+    frame[0] = dest;
+    frame[1] = payload_length + 2; // Size of payload + type + CRC
+    frame[2] = type;
+    frame[payload_length + 3] = crc8(&frame[2], payload_length + 1);
+
+    return payload_length + 4;
+}
+
+size_t crsf_build_frame(uint8_t *frame, uint8_t dest, uint8_t type, const void *payload, uint8_t payload_length)
+{
+    if (payload_length > CRSF_MAX_PAYLOAD_SIZE) {
+        return 0;
+    }
+
+    memcpy(&frame[3], payload, payload_length);
+    return crsf_finish_frame(frame, dest, type, payload_length);
+}
+
+size_t crsf_build_command_frame(uint8_t *frame, uint8_t dest, uint8_t origin, uint8_t command, uint8_t subcommand,
+                                const void *payload, uint8_t payload_length)
+{
+    if (payload_length > CRSF_COMMAND_MAX_PAYLOAD_SIZE) {
+        return 0;
+    }
+
+    frame[2] = CRSF_TYPE_COMMAND;
+    frame[3] = dest;
+    frame[4] = origin;
+    frame[5] = command;
+    frame[6] = subcommand;
+    memcpy(&frame[7], payload, payload_length);
+    // the command CRC covers the frame type too
+    frame[7 + payload_length] = crsf_crc8(CRSF_CRC_COMMAND, 0, &frame[2], CRSF_COMMAND_HEADER_SIZE + payload_length + 1);
+
+    return crsf_finish_frame(frame, dest, CRSF_TYPE_COMMAND, CRSF_COMMAND_HEADER_SIZE + payload_length + 1);
+}
+
+bool crsf_command_valid(const crsf_frame_t *frame)
+{
+    if (frame->type != CRSF_TYPE_COMMAND || frame->payload_length < CRSF_COMMAND_HEADER_SIZE + 1) {
+        return false;
+    }
+
+    uint8_t type = CRSF_TYPE_COMMAND;
+    uint8_t crc = crsf_crc8(CRSF_CRC_COMMAND, 0, &type, 1);
+    crc = crsf_crc8(CRSF_CRC_COMMAND, crc, frame->payload, frame->payload_length - 1);
+    return crc == frame->payload[frame->payload_length - 1];
+}
+
+CRSF_IRAM_ATTR void crsf_unpack_channels(const uint8_t *payload, uint16_t *values)
+{
+    // channels are packed LSB first, 11 bits each
+    uint32_t bits = 0;
+    uint8_t bit_count = 0;
+
+    for (int ch = 0; ch < 16; ch++) {
+        while (bit_count < 11) {
+            bits |= (uint32_t)*payload++ << bit_count;
+            bit_count += 8;
+        }
+        values[ch] = bits & 0x7FF;
+        bits >>= 11;
+        bit_count -= 11;
+    }
+}
+
+CRSF_IRAM_ATTR void crsf_pack_channels(const uint16_t *values, uint8_t *payload)
+{
+    uint32_t bits = 0;
+    uint8_t bit_count = 0;
+
+    for (int ch = 0; ch < 16; ch++) {
+        bits |= (uint32_t)(values[ch] & 0x7FF) << bit_count;
+        bit_count += 11;
+        while (bit_count >= 8) {
+            *payload++ = bits & 0xFF;
+            bits >>= 8;
+            bit_count -= 8;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#include <string.h>
+#include "crsf_internal.h"
+#include "crsf_attr.h"
+
+/*
+ * Ring of the last CONFIG_CRSF_CHANNEL_HISTORY_SIZE channels frames. Every
+ * frame gets a sequence number; readers keep the number of the next frame
+ * they want as a cursor, so any number of readers can walk the ring at their
+ * own pace and tell exactly how many frames they missed.
+ */
+
+#define HISTORY_SIZE CONFIG_CRSF_CHANNEL_HISTORY_SIZE
+
+// the ring index stays continuous when the sequence number wraps
+_Static_assert((HISTORY_SIZE & (HISTORY_SIZE - 1)) == 0, "CONFIG_CRSF_CHANNEL_HISTORY_SIZE must be a power of two");
+
+static portMUX_TYPE history_lock = portMUX_INITIALIZER_UNLOCKED;
+static crsf_channel_sample_t history[HISTORY_SIZE];
+static uint32_t next_seq; // sequence number of the next frame pushed, never reset
+
+CRSF_IRAM_ATTR void crsf_history_push(const uint8_t *payload, int64_t arrival_us)
+{
+    portENTER_CRITICAL(&history_lock);
+    crsf_channel_sample_t *sample = &history[next_seq % HISTORY_SIZE];
+    memcpy(&sample->channels, payload, sizeof(sample->channels));
+    sample->arrival_us = arrival_us;
+    sample->seq = next_seq++;
+    portEXIT_CRITICAL(&history_lock);
+}
+
+uint32_t CRSF_channel_history_cursor(void)
+{
+    portENTER_CRITICAL(&history_lock);
+    uint32_t seq = next_seq;
+    portEXIT_CRITICAL(&history_lock);
+    return seq;
+}
+
+size_t CRSF_channel_history_read(uint32_t *cursor, crsf_channel_sample_t *samples, size_t max_samples, uint32_t *lost)
+{
+    size_t count = 0;
+    uint32_t missed = 0;
+
+    // one sample per critical section, rx_task is never held up by a long copy
+    while (count < max_samples) {
+        portENTER_CRITICAL(&history_lock);
+        uint32_t available = next_seq - *cursor;
+        if (available == 0) {
+            portEXIT_CRITICAL(&history_lock);
+            break;
+        }
+        if (available > HISTORY_SIZE) {
+            // overwritten before this reader got to them
+            missed += available - HISTORY_SIZE;
+            *cursor = next_seq - HISTORY_SIZE;
+        }
+        samples[count++] = history[*cursor % HISTORY_SIZE];
+        (*cursor)++;
+        portEXIT_CRITICAL(&history_lock);
+    }
+
+    if (lost != NULL) {
+        *lost = missed;
+    }
+    return count;
+}
@@ -0,0 +1,230 @@
+#include <inttypes.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "crsf_frame.h"
+#include "crsf_internal.h"
+#include "crsf_attr.h"
+
+#define BITS_PER_BYTE 10 // start + 8 data + stop
+#define CHANNELS_FRAME_SIZE (CRSF_CHANNELS_PAYLOAD_SIZE + 4)
+#define MAX_EDGE_AGE_US 5000 // an edge older than this at rx_task wake-up belongs to an earlier frame
+
+volatile bool crsf_latency_active = false;
+
+static portMUX_TYPE latency_lock = portMUX_INITIALIZER_UNLOCKED;
+static crsf_latency_config_t latency_config;
+static crsf_latency_report_t latency_report;
+static gpio_num_t edge_pin = GPIO_NUM_NC;
+
+// 64-bit, so written by the GPIO ISR and read by rx_task only under edge_lock
+static portMUX_TYPE edge_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t edge_us; // first start bit after the edge interrupt was armed, 0 if none yet
+static int64_t rx_wake_us;
+static size_t rx_event_size;
+static int last_toggle_value = -1;
+
+// published sample waiting for a consumer to observe it
+static bool pending = false;
+static int64_t pending_edge_us;
+static int64_t pending_published_us;
+
+static void IRAM_ATTR edge_isr(void *arg)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL_ISR(&edge_lock);
+    edge_us = now_us;
+    portEXIT_CRITICAL_ISR(&edge_lock);
+    // one edge per frame is enough, everything after the start bit would flood the CPU
+    gpio_intr_disable(edge_pin);
+}
+
+static CRSF_IRAM_ATTR void set_edge(int64_t us)
+{
+    portENTER_CRITICAL_SAFE(&edge_lock);
+    edge_us = us;
+    portEXIT_CRITICAL_SAFE(&edge_lock);
+}
+
+static CRSF_IRAM_ATTR int64_t get_edge(void)
+{
+    portENTER_CRITICAL_SAFE(&edge_lock);
+    int64_t us = edge_us;
+    portEXIT_CRITICAL_SAFE(&edge_lock);
+    return us;
+}
+
+// must be called with latency_lock held
+static CRSF_IRAM_ATTR void record(crsf_latency_stage_t stage, int64_t us)
+{
+    crsf_latency_histogram_t *hist = &latency_report.stage[stage];
+    uint32_t value = us < 0 ? 0 : (us > UINT32_MAX ? UINT32_MAX : (uint32_t)us);
+    int bucket = value == 0 ? 0 : 31 - __builtin_clz(value);
+
+    if (bucket >= CRSF_LATENCY_BUCKETS) {
+        bucket = CRSF_LATENCY_BUCKETS - 1;
+    }
+    hist->buckets[bucket]++;
+    if (hist->count == 0 || value < hist->min_us) {
+        hist->min_us = value;
+    }
+    if (value > hist->max_us) {
+        hist->max_us = value;
+    }
+    hist->sum_us += value;
+    hist->count++;
+}
+
+CRSF_IRAM_ATTR void crsf_latency_rx_wake(int64_t now_us, size_t event_size)
+{
+    rx_wake_us = now_us;
+    rx_event_size = event_size;
+}
+
+CRSF_IRAM_ATTR void crsf_latency_channels_published(const uint8_t *payload, int64_t parsed_us)
+{
+    int64_t published_us = esp_timer_get_time();
+    int64_t start_us = get_edge();
+    int64_t wire_us = CHANNELS_FRAME_SIZE * BITS_PER_BYTE * 1000000LL / crsf_get_config()->baud_rate;
+    bool changed = true;
+
+    if (latency_config.toggle_channel >= 0) {
+        uint16_t values[16];
+        crsf_unpack_channels(payload, values);
+        int value = values[latency_config.toggle_channel];
+        changed = last_toggle_value >= 0 && value != last_toggle_value;
+        last_toggle_value = value;
+    }
+
+    // the edge is only known to be this frame's start bit if the UART event held nothing else
+    bool valid = changed && start_us != 0 && rx_event_size == CHANNELS_FRAME_SIZE &&
+                 rx_wake_us >= start_us + wire_us && rx_wake_us - start_us <= MAX_EDGE_AGE_US;
+
+    portENTER_CRITICAL(&latency_lock);
+    if (valid) {
+        record(CRSF_LATENCY_WIRE, wire_us);
+        record(CRSF_LATENCY_UART, rx_wake_us - (start_us + wire_us));
+        record(CRSF_LATENCY_RX_TASK, parsed_us - rx_wake_us);
+        record(CRSF_LATENCY_PUBLISH, published_us - parsed_us);
+        pending = true;
+        pending_edge_us = start_us;
+        pending_published_us = published_us;
+    } else {
+        latency_report.rejected++;
+    }
+    portEXIT_CRITICAL(&latency_lock);
+}
+
+CRSF_IRAM_ATTR void crsf_latency_rx_done(void)
+{
+    // arm the edge interrupt for the start bit of the next frame
+    set_edge(0);
+    gpio_intr_enable(edge_pin);
+}
+
+CRSF_IRAM_ATTR void crsf_latency_consumer_observed(void)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&latency_lock);
+    if (pending) {
+        pending = false;
+        record(CRSF_LATENCY_CONSUMER, now_us - pending_published_us);
+        record(CRSF_LATENCY_TOTAL, now_us - pending_edge_us);
+    }
+    portEXIT_CRITICAL(&latency_lock);
+}
+
+esp_err_t CRSF_latency_start(const crsf_latency_config_t *config)
+{
+    if (config->toggle_channel >= 16) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (crsf_get_config()->input != CRSF_INPUT_CRSF) {
+        return ESP_ERR_NOT_SUPPORTED; // stage boundaries assume CRSF channels frames
+    }
+
+    CRSF_latency_stop();
+
+    portENTER_CRITICAL(&latency_lock);
+    memset(&latency_report, 0, sizeof(latency_report));
+    latency_config = *config;
+    last_toggle_value = -1;
+    pending = false;
+    portEXIT_CRITICAL(&latency_lock);
+
+    edge_pin = crsf_get_config()->rx_pin;
+    set_edge(0);
+
+    // the ISR service may already be installed by the application, then it is left alone
+    esp_err_t err = gpio_install_isr_service(0);
+    bool own_service = err == ESP_OK;
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        return err;
+    }
+    // only the interrupt type is changed, the pin stays routed to the UART
+    err = gpio_set_intr_type(edge_pin, GPIO_INTR_NEGEDGE);
+    if (err == ESP_OK) {
+        err = gpio_isr_handler_add(edge_pin, edge_isr, NULL);
+        if (err == ESP_OK) {
+            crsf_latency_active = true;
+            err = gpio_intr_enable(edge_pin);
+            if (err == ESP_OK) {
+                return ESP_OK;
+            }
+            crsf_latency_active = false;
+            gpio_isr_handler_remove(edge_pin);
+        }
+        gpio_set_intr_type(edge_pin, GPIO_INTR_DISABLE);
+    }
+    if (own_service) {
+        gpio_uninstall_isr_service();
+    }
+    return err;
+}
+
+void CRSF_latency_stop(void)
+{
+    if (!crsf_latency_active) {
+        return;
+    }
+    crsf_latency_active = false;
+    gpio_intr_disable(edge_pin);
+    gpio_isr_handler_remove(edge_pin);
+    gpio_set_intr_type(edge_pin, GPIO_INTR_DISABLE);
+}
+
+void CRSF_latency_get_report(crsf_latency_report_t *report)
+{
+    portENTER_CRITICAL(&latency_lock);
+    *report = latency_report;
+    portEXIT_CRITICAL(&latency_lock);
+}
+
+void CRSF_latency_print_report(const crsf_latency_report_t *report)
+{
+    static const char *names[CRSF_LATENCY_STAGES] = { "wire", "uart", "rx_task", "publish", "consumer", "total" };
+
+    for (int stage = 0; stage < CRSF_LATENCY_STAGES; stage++) {
+        const crsf_latency_histogram_t *hist = &report->stage[stage];
+        if (hist->count == 0) {
+            ESP_LOGI(CRSF_TAG, "%-8s no samples", names[stage]);
+            continue;
+        }
+
+        char line[CRSF_LATENCY_BUCKETS * 16] = {0};
+        size_t len = 0;
+        for (int bucket = 0; bucket < CRSF_LATENCY_BUCKETS && len < sizeof(line); bucket++) {
+            if (hist->buckets[bucket] > 0) {
+                len += snprintf(line + len, sizeof(line) - len, " <%" PRIu32 ":%" PRIu32,
+                                (uint32_t)2 << bucket, hist->buckets[bucket]);
+            }
+        }
+
+        ESP_LOGI(CRSF_TAG, "%-8s n=%" PRIu32 " min=%" PRIu32 " avg=%" PRIu32 " max=%" PRIu32 " us |%s",
+                 names[stage], hist->count, hist->min_us, (uint32_t)(hist->sum_us / hist->count),
+                 hist->max_us, line);
+    }
+    ESP_LOGI(CRSF_TAG, "rejected %" PRIu32 " frames", report->rejected);
+}
@@ -0,0 +1,210 @@
+#include <string.h>
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "crsf_internal.h"
+
+#define WAKE_THRESHOLD 3      // RX edges that wake the chip from light sleep, the waking frame is lost
+#define MISS_HOLD_INTERVALS 2 // a window without a frame is closed after this many frame intervals
+
+/*
+ * Light sleep is blocked with a NO_LIGHT_SLEEP lock from guard_us before each
+ * predicted channels frame until it is decoded. In between the chip may sleep;
+ * the window timer is an esp_timer alarm, which automatic light sleep wakes up
+ * for. If frames stop coming the lock is dropped and UART wakeup brings the
+ * chip back once the link resumes.
+ *
+ * held is the state decided under the spinlock by the window timer, rx_task
+ * and start/stop. The pm lock calls cannot be made under the spinlock, so the
+ * one caller that claims pm_syncing applies held to the pm lock and repeats
+ * until the two agree; a decision made meanwhile by another caller is
+ * picked up by that loop instead of racing it.
+ */
+
+volatile bool crsf_low_power_active = false;
+
+static portMUX_TYPE low_power_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_pm_lock_handle_t pm_lock;
+static esp_timer_handle_t window_timer;
+static bool held;             // pm_lock should be acquired by this module
+static bool pm_acquired;      // pm_lock is acquired by this module
+static bool pm_syncing;       // a caller is applying held to pm_lock
+static bool window_open;      // held because the window timer fired, not waiting for the first frame
+static int64_t held_since_us;
+static int64_t window_open_us;
+static uint32_t frame_interval_us;
+static int64_t started_us;
+static uint64_t awake_us;
+static uint64_t wake_to_decode_sum_us;
+static crsf_low_power_stats_t stats;
+
+// bring pm_lock in line with held, called after every change of held
+static void sync_pm_lock(void)
+{
+    portENTER_CRITICAL(&low_power_lock);
+    if (pm_syncing) {
+        // the caller already syncing sees the new state before it lets go
+        portEXIT_CRITICAL(&low_power_lock);
+        return;
+    }
+    pm_syncing = true;
+    while (pm_acquired != held) {
+        bool acquire = held;
+        portEXIT_CRITICAL(&low_power_lock);
+        if (acquire) {
+            esp_pm_lock_acquire(pm_lock);
+        } else {
+            esp_pm_lock_release(pm_lock);
+        }
+        portENTER_CRITICAL(&low_power_lock);
+        pm_acquired = acquire;
+    }
+    pm_syncing = false;
+    portEXIT_CRITICAL(&low_power_lock);
+}
+
+static void window_timer_callback(void *arg)
+{
+    int64_t now_us = esp_timer_get_time();
+    bool acquire = false;
+
+    portENTER_CRITICAL(&low_power_lock);
+    if (!held) {
+        held = acquire = true;
+        window_open = true;
+        held_since_us = window_open_us = now_us;
+        stats.windows++;
+    } else if (window_open) {
+        // the predicted frame did not come, sleep until UART activity
+        held = window_open = false;
+        awake_us += now_us - held_since_us;
+        stats.windows_missed++;
+    }
+    portEXIT_CRITICAL(&low_power_lock);
+
+    sync_pm_lock();
+    if (acquire) {
+        // keep the window open for a few intervals in case the frame is late
+        esp_timer_start_once(window_timer, CONFIG_CRSF_LOW_POWER_GUARD_US + MISS_HOLD_INTERVALS * frame_interval_us);
+    }
+}
+
+void crsf_low_power_frame(int64_t arrival_us, uint32_t interval_us)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    if (interval_us == 0) {
+        return; // stay awake until the frame rate is known
+    }
+
+    portENTER_CRITICAL(&low_power_lock);
+    frame_interval_us = interval_us;
+    if (held) {
+        if (window_open) {
+            uint32_t latency_us = now_us - window_open_us;
+            stats.frames++;
+            wake_to_decode_sum_us += latency_us;
+            if (latency_us > stats.wake_to_decode_max_us) {
+                stats.wake_to_decode_max_us = latency_us;
+            }
+        }
+        awake_us += now_us - held_since_us;
+        held = window_open = false;
+    }
+    portEXIT_CRITICAL(&low_power_lock);
+
+    sync_pm_lock();
+
+    // open the next window guard_us before the predicted arrival
+    int64_t open_us = arrival_us + interval_us - CONFIG_CRSF_LOW_POWER_GUARD_US;
+    esp_timer_stop(window_timer);
+    esp_timer_start_once(window_timer, open_us > now_us ? open_us - now_us : 0);
+}
+
+esp_err_t CRSF_low_power_start(void)
+{
+    if (crsf_low_power_active) {
+        return ESP_OK;
+    }
+    if (crsf_get_rx_task() == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (crsf_get_config()->input == CRSF_INPUT_PPM) {
+        return ESP_ERR_NOT_SUPPORTED; // wakeup is set up for the UART
+    }
+
+    esp_err_t err;
+    if (pm_lock == NULL) {
+        err = esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "crsf_rx", &pm_lock);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    if (window_timer == NULL) {
+        esp_timer_create_args_t timer_args = {
+            .callback = window_timer_callback,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "crsf_window",
+            .skip_unhandled_events = false, // must wake the chip from light sleep
+        };
+        err = esp_timer_create(&timer_args, &window_timer);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    // UART wakeup is only available on some ports, the backstop for lost windows
+    uart_port_t uart = crsf_get_config()->uart_num;
+    err = uart_set_wakeup_threshold(uart, WAKE_THRESHOLD);
+    if (err == ESP_OK) {
+        err = esp_sleep_enable_uart_wakeup(uart);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    portENTER_CRITICAL(&low_power_lock);
+    memset(&stats, 0, sizeof(stats));
+    awake_us = 0;
+    wake_to_decode_sum_us = 0;
+    started_us = held_since_us = esp_timer_get_time();
+    held = true; // awake until the first frame gives a phase to predict from
+    window_open = false;
+    portEXIT_CRITICAL(&low_power_lock);
+
+    sync_pm_lock();
+    crsf_low_power_active = true;
+    return ESP_OK;
+}
+
+void CRSF_low_power_stop(void)
+{
+    if (!crsf_low_power_active) {
+        return;
+    }
+    crsf_low_power_active = false;
+    esp_timer_stop(window_timer);
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_UART);
+
+    portENTER_CRITICAL(&low_power_lock);
+    if (held) {
+        awake_us += esp_timer_get_time() - held_since_us;
+    }
+    held = window_open = false;
+    portEXIT_CRITICAL(&low_power_lock);
+
+    sync_pm_lock();
+}
+
+void CRSF_low_power_get_stats(crsf_low_power_stats_t *out)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&low_power_lock);
+    *out = stats;
+    uint64_t awake = awake_us + (held ? now_us - held_since_us : 0);
+    int64_t elapsed_us = now_us - started_us;
+    out->wake_to_decode_avg_us = stats.frames ? wake_to_decode_sum_us / stats.frames : 0;
+    out->awake_permille = elapsed_us > 0 ? awake * 1000 / elapsed_us : 1000;
+    portEXIT_CRITICAL(&low_power_lock);
+}
@@ -0,0 +1,154 @@
+#include <string.h>
+#include "freertos/stream_buffer.h"
+#include "crsf_frame.h"
+#include "crsf_internal.h"
+
+#define MAX_PACKET_SIZE 280 // MAVLink v2 with signature
+#define CHUNK_RETRY_MS 20   // a full transmit queue of 64 byte frames empties in about 12 ms at 420000 baud
+
+// receive side, only touched by rx_task apart from the stream buffer
+static uint8_t rx_storage[CONFIG_CRSF_MAVLINK_RX_BUF_SIZE + 1];
+static StaticStreamBuffer_t rx_stream_struct;
+static StreamBufferHandle_t rx_stream;
+static uint8_t packet[MAX_PACKET_SIZE];
+static size_t packet_length;
+static uint8_t next_chunk; // 0 while no packet is being reassembled
+static uint8_t total_chunks;
+
+static StaticSemaphore_t tx_lock_struct;
+static SemaphoreHandle_t tx_lock;
+
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static crsf_mavlink_stats_t stats;
+
+static void count(uint32_t *counter)
+{
+    portENTER_CRITICAL(&stats_lock);
+    (*counter)++;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+void crsf_mavlink_init(void)
+{
+    if (rx_stream == NULL) {
+        rx_stream = xStreamBufferCreateStatic(CONFIG_CRSF_MAVLINK_RX_BUF_SIZE, 1, rx_storage, &rx_stream_struct);
+        tx_lock = xSemaphoreCreateMutexStatic(&tx_lock_struct);
+    }
+    xStreamBufferReset(rx_stream);
+    next_chunk = 0;
+}
+
+void crsf_mavlink_frame(const uint8_t *payload, uint8_t payload_length)
+{
+    if (payload_length < 2) {
+        return;
+    }
+
+    uint8_t current = payload[0] >> 4;
+    uint8_t total = payload[0] & 0x0F;
+    uint8_t data_size = payload[1];
+
+    if (total == 0 || current >= total || data_size > payload_length - 2) {
+        count(&stats.rx_dropped);
+        next_chunk = 0;
+        return;
+    }
+
+    if (current == 0) {
+        if (next_chunk != 0) {
+            count(&stats.rx_dropped); // the previous packet never completed
+        }
+        packet_length = 0;
+        total_chunks = total;
+    } else if (current != next_chunk || total != total_chunks) {
+        if (next_chunk != 0) {
+            count(&stats.rx_dropped);
+        }
+        next_chunk = 0;
+        return;
+    }
+
+    if (packet_length + data_size > sizeof(packet)) {
+        count(&stats.rx_overflows);
+        next_chunk = 0;
+        return;
+    }
+    memcpy(&packet[packet_length], &payload[2], data_size);
+    packet_length += data_size;
+    next_chunk = current + 1;
+
+    if (next_chunk < total_chunks) {
+        return;
+    }
+    next_chunk = 0;
+
+    // whole packets only, a reader must never see a truncated one
+    if (xStreamBufferSpacesAvailable(rx_stream) < packet_length) {
+        count(&stats.rx_overflows);
+        return;
+    }
+    xStreamBufferSend(rx_stream, packet, packet_length, 0);
+    count(&stats.rx_packets);
+}
+
+size_t CRSF_mavlink_read(void *data, size_t max_length, TickType_t timeout)
+{
+    return xStreamBufferReceive(rx_stream, data, max_length, timeout);
+}
+
+esp_err_t CRSF_mavlink_write(const void *data, size_t length)
+{
+    const uint8_t *bytes = data;
+    size_t chunks = (length + CRSF_MAVLINK_CHUNK_SIZE - 1) / CRSF_MAVLINK_CHUNK_SIZE;
+    uint8_t frame[CRSF_MAX_FRAME_SIZE];
+
+    if (length == 0 || chunks > CRSF_MAVLINK_MAX_CHUNKS) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (crsf_get_config()->input != CRSF_INPUT_CRSF) {
+        return ESP_ERR_INVALID_STATE; // SBUS and PPM have no return path
+    }
+
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(tx_lock, portMAX_DELAY);
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+        size_t size = length > CRSF_MAVLINK_CHUNK_SIZE ? CRSF_MAVLINK_CHUNK_SIZE : length;
+
+        // envelope written in place behind the frame header, no intermediate payload copy
+        frame[3] = (chunk << 4) | chunks;
+        frame[4] = size;
+        memcpy(&frame[5], bytes, size);
+        size_t frame_length = crsf_finish_frame(frame, CRSF_DEST_FC, CRSF_TYPE_MAVLINK_ENVELOPE, size + 2);
+
+        // a packet has more chunks than the transmit queue has slots, wait for the UART to catch up
+        TickType_t start = xTaskGetTickCount();
+        while (!crsf_send_frame(frame, frame_length)) {
+            if (xTaskGetTickCount() - start > pdMS_TO_TICKS(CHUNK_RETRY_MS)) {
+                err = ESP_ERR_TIMEOUT;
+                break;
+            }
+            vTaskDelay(1);
+        }
+        if (err != ESP_OK) {
+            // the receiving side discards the incomplete packet
+            break;
+        }
+
+        bytes += size;
+        length -= size;
+        count(&stats.tx_frames);
+    }
+    xSemaphoreGive(tx_lock);
+
+    if (err == ESP_OK) {
+        count(&stats.tx_packets);
+    }
+    return err;
+}
+
+void CRSF_mavlink_get_stats(crsf_mavlink_stats_t *out)
+{
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+}
@@ -0,0 +1,368 @@
+#include <string.h>
+#include "driver/ledc.h"
+#include "driver/rmt_tx.h"
+#include "driver/uart.h"
+#include "esp_timer.h"
+#include "crsf_frame.h"
+#include "crsf_sbus.h"
+#include "crsf_internal.h"
+
+/*
+ * Outputs are updated from rx_task as each channels frame is decoded and from
+ * the failsafe timer; the pulse timing itself is left to the LEDC, RMT and
+ * UART hardware. PPM needs a continuous pulse train, so an esp_timer queues
+ * one RMT transmission per PPM frame from the latest values.
+ */
+
+#define PWM_RESOLUTION LEDC_TIMER_14_BIT
+#define PWM_MAX_DUTY (1u << 14)
+#define PPM_RESOLUTION_HZ 1000000
+#define PPM_PULSE_US 300
+#define PPM_FRAME_US 22500
+#define PPM_MARGIN_US 500 // transmission ends this long before the next one is queued, the idle level extends the sync gap
+#define PPM_MIN_SYNC_US 3000
+#define SBUS_MIN_GAP_US 1000 // idle time between SBUS frames
+
+volatile bool crsf_output_active = false;
+
+static crsf_output_config_t output_config;
+static uint16_t values[16];
+static bool pulses; // false before the first frame and after a no-pulses failsafe
+static portMUX_TYPE output_lock = portMUX_INITIALIZER_UNLOCKED;
+static crsf_output_stats_t stats;
+static uint64_t latency_sum_us;
+
+static rmt_channel_handle_t ppm_channel;
+static rmt_encoder_handle_t ppm_encoder;
+static esp_timer_handle_t ppm_timer;
+static rmt_symbol_word_t ppm_symbols[2][17]; // transmissions alternate so the queued one is never rewritten
+static uint8_t ppm_buffer;
+
+// rx_task and the failsafe timer both send SBUS frames, output_lock picks one writer per frame gap
+static int64_t sbus_last_us;
+static bool sbus_writing;
+
+static void set_pwm(int index, uint16_t us)
+{
+    uint32_t duty = (uint64_t)us * output_config.pwm_rate_hz * PWM_MAX_DUTY / 1000000;
+    ledc_set_duty(LEDC_LOW_SPEED_MODE, index, duty);
+    ledc_update_duty(LEDC_LOW_SPEED_MODE, index);
+}
+
+static void update_pwm(const uint16_t *channels, bool pulses)
+{
+    for (int i = 0; i < output_config.num_pwm; i++) {
+        if (output_config.pwm_pins[i] < 0) {
+            continue;
+        }
+        if (pulses) {
+            // takes effect at the start of the next PWM period
+            set_pwm(i, crsf_channel_to_us(channels[i]));
+        } else {
+            ledc_stop(LEDC_LOW_SPEED_MODE, i, 0);
+        }
+    }
+}
+
+static void update_sbus(const uint16_t *channels, uint8_t flags, int64_t now_us)
+{
+    // a new frame would only queue behind the one still on the wire, the next channels frame brings fresher values
+    portENTER_CRITICAL(&output_lock);
+    bool due = !sbus_writing && now_us - sbus_last_us >= CRSF_SBUS_FRAME_TIME_US + SBUS_MIN_GAP_US;
+    if (due) {
+        sbus_writing = true;
+        sbus_last_us = now_us;
+    }
+    portEXIT_CRITICAL(&output_lock);
+    if (!due) {
+        return;
+    }
+
+    uint8_t frame[CRSF_SBUS_FRAME_SIZE];
+    crsf_sbus_build_frame(frame, channels, flags);
+    uart_write_bytes(output_config.sbus_uart, frame, sizeof(frame));
+
+    portENTER_CRITICAL(&output_lock);
+    sbus_writing = false;
+    portEXIT_CRITICAL(&output_lock);
+}
+
+static void ppm_timer_callback(void *arg)
+{
+    uint16_t channels[16];
+    bool send;
+
+    portENTER_CRITICAL(&output_lock);
+    memcpy(channels, values, sizeof(channels));
+    send = pulses;
+    portEXIT_CRITICAL(&output_lock);
+
+    if (!send) {
+        return;
+    }
+
+    rmt_symbol_word_t *symbols = ppm_symbols[ppm_buffer];
+    uint32_t total_us = 0;
+    int n = 0;
+
+    ppm_buffer ^= 1;
+    for (; n < output_config.ppm_channels; n++) {
+        uint16_t us = crsf_channel_to_us(channels[n]);
+        symbols[n] = (rmt_symbol_word_t){ .level0 = 0, .duration0 = PPM_PULSE_US, .level1 = 1, .duration1 = us - PPM_PULSE_US };
+        total_us += us;
+    }
+    // closing pulse, then the sync gap up to the frame length
+    uint32_t sync_us = PPM_FRAME_US - PPM_MARGIN_US - PPM_PULSE_US - total_us;
+    if (total_us + PPM_PULSE_US + PPM_MIN_SYNC_US > PPM_FRAME_US - PPM_MARGIN_US) {
+        sync_us = PPM_MIN_SYNC_US;
+    }
+    symbols[n++] = (rmt_symbol_word_t){ .level0 = 0, .duration0 = PPM_PULSE_US, .level1 = 1, .duration1 = sync_us };
+
+    rmt_transmit_config_t tx_config = { .loop_count = 0, .flags.eot_level = 1 };
+    rmt_transmit(ppm_channel, ppm_encoder, symbols, n * sizeof(rmt_symbol_word_t), &tx_config);
+}
+
+static void record_latency(int64_t arrival_us)
+{
+    uint32_t latency_us = esp_timer_get_time() - arrival_us;
+
+    portENTER_CRITICAL(&output_lock);
+    stats.updates++;
+    latency_sum_us += latency_us;
+    if (latency_us > stats.update_latency_max_us) {
+        stats.update_latency_max_us = latency_us;
+    }
+    portEXIT_CRITICAL(&output_lock);
+}
+
+void crsf_output_channels(const uint8_t *payload, int64_t arrival_us)
+{
+    uint16_t channels[16];
+    crsf_unpack_channels(payload, channels);
+
+    portENTER_CRITICAL(&output_lock);
+    memcpy(values, channels, sizeof(values));
+    pulses = true;
+    portEXIT_CRITICAL(&output_lock);
+
+    update_pwm(channels, true);
+    if (output_config.sbus_pin >= 0) {
+        update_sbus(channels, 0, esp_timer_get_time());
+    }
+    record_latency(arrival_us);
+}
+
+void crsf_output_failsafe(void)
+{
+    uint16_t channels[16];
+    crsf_output_failsafe_t policy = output_config.failsafe;
+
+    portENTER_CRITICAL(&output_lock);
+    if (policy == CRSF_OUTPUT_FAILSAFE_PRESET) {
+        for (int ch = 0; ch < 16; ch++) {
+            uint16_t us = output_config.failsafe_us[ch];
+            values[ch] = crsf_us_to_channel(us ? us : 1500);
+        }
+    }
+    if (policy == CRSF_OUTPUT_FAILSAFE_NO_PULSES) {
+        pulses = false;
+    } else if (policy == CRSF_OUTPUT_FAILSAFE_PRESET) {
+        pulses = true;
+    }
+    bool active = pulses;
+    memcpy(channels, values, sizeof(channels));
+    stats.failsafes++;
+    portEXIT_CRITICAL(&output_lock);
+
+    // PWM already holds the last values by itself
+    if (policy != CRSF_OUTPUT_FAILSAFE_HOLD) {
+        update_pwm(channels, active);
+    }
+    if (output_config.sbus_pin >= 0 && active) {
+        // SBUS carries the failsafe state itself, receivers downstream apply their own policy as well
+        update_sbus(channels, CRSF_SBUS_FLAG_FRAME_LOST | CRSF_SBUS_FLAG_FAILSAFE, esp_timer_get_time());
+    }
+}
+
+static esp_err_t start_pwm(void)
+{
+    if (output_config.num_pwm > CRSF_OUTPUT_MAX_PWM || output_config.num_pwm > SOC_LEDC_CHANNEL_NUM) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (output_config.num_pwm == 0) {
+        return ESP_OK;
+    }
+
+    ledc_timer_config_t timer_config = {
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .duty_resolution = PWM_RESOLUTION,
+        .timer_num = CONFIG_CRSF_OUTPUT_LEDC_TIMER,
+        .freq_hz = output_config.pwm_rate_hz,
+        .clk_cfg = LEDC_AUTO_CLK,
+    };
+    esp_err_t err = ledc_timer_config(&timer_config);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    for (int i = 0; i < output_config.num_pwm; i++) {
+        if (output_config.pwm_pins[i] < 0) {
+            continue;
+        }
+        // no pulses until the first frame or the failsafe policy says otherwise
+        ledc_channel_config_t channel_config = {
+            .gpio_num = output_config.pwm_pins[i],
+            .speed_mode = LEDC_LOW_SPEED_MODE,
+            .channel = i,
+            .intr_type = LEDC_INTR_DISABLE,
+            .timer_sel = CONFIG_CRSF_OUTPUT_LEDC_TIMER,
+            .duty = 0,
+            .hpoint = 0,
+        };
+        err = ledc_channel_config(&channel_config);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t start_ppm(void)
+{
+    if (output_config.ppm_pin < 0) {
+        return ESP_OK;
+    }
+    if (output_config.ppm_channels == 0 || output_config.ppm_channels > 16) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    rmt_tx_channel_config_t channel_config = {
+        .gpio_num = output_config.ppm_pin,
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = PPM_RESOLUTION_HZ,
+        .mem_block_symbols = 64,
+        .trans_queue_depth = 1,
+    };
+    esp_err_t err = rmt_new_tx_channel(&channel_config, &ppm_channel);
+    if (err != ESP_OK) {
+        return err;
+    }
+    rmt_copy_encoder_config_t encoder_config = {};
+    err = rmt_new_copy_encoder(&encoder_config, &ppm_encoder);
+    if (err == ESP_OK) {
+        err = rmt_enable(ppm_channel);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    esp_timer_create_args_t timer_args = {
+        .callback = ppm_timer_callback,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "crsf_ppm",
+    };
+    err = esp_timer_create(&timer_args, &ppm_timer);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return esp_timer_start_periodic(ppm_timer, PPM_FRAME_US);
+}
+
+static esp_err_t start_sbus(void)
+{
+    if (output_config.sbus_pin < 0) {
+        return ESP_OK;
+    }
+
+    uart_config_t uart_config = {
+        .baud_rate = CRSF_SBUS_BAUD_RATE,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = UART_PARITY_EVEN,
+        .stop_bits = UART_STOP_BITS_2,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE
+    };
+    esp_err_t err = uart_param_config(output_config.sbus_uart, &uart_config);
+    if (err == ESP_OK) {
+        err = uart_set_pin(output_config.sbus_uart, output_config.sbus_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    }
+    if (err == ESP_OK) {
+        err = uart_set_line_inverse(output_config.sbus_uart, UART_SIGNAL_TXD_INV);
+    }
+    if (err == ESP_OK) {
+        // no TX ring buffer: a frame goes straight into the hardware FIFO, uart_write_bytes never waits for it
+        err = uart_driver_install(output_config.sbus_uart, SOC_UART_FIFO_LEN * 2, 0, 0, NULL, 0);
+    }
+    sbus_last_us = 0;
+    sbus_writing = false;
+    return err;
+}
+
+esp_err_t CRSF_output_start(const crsf_output_config_t *config)
+{
+    CRSF_output_stop();
+
+    output_config = *config;
+    if (output_config.pwm_rate_hz == 0) {
+        output_config.pwm_rate_hz = 50;
+    }
+    memset(&stats, 0, sizeof(stats));
+    latency_sum_us = 0;
+    pulses = false;
+
+    esp_err_t err = start_pwm();
+    if (err == ESP_OK) {
+        err = start_ppm();
+    }
+    if (err == ESP_OK) {
+        err = start_sbus();
+    }
+    if (err != ESP_OK) {
+        CRSF_output_stop();
+        return err;
+    }
+
+    if (output_config.failsafe == CRSF_OUTPUT_FAILSAFE_PRESET) {
+        crsf_output_failsafe();
+        stats.failsafes = 0;
+    }
+    crsf_output_active = true;
+    return ESP_OK;
+}
+
+void CRSF_output_stop(void)
+{
+    crsf_output_active = false;
+
+    if (ppm_timer != NULL) {
+        esp_timer_stop(ppm_timer);
+        esp_timer_delete(ppm_timer);
+        ppm_timer = NULL;
+    }
+    if (ppm_channel != NULL) {
+        rmt_disable(ppm_channel);
+        rmt_del_channel(ppm_channel);
+        ppm_channel = NULL;
+    }
+    if (ppm_encoder != NULL) {
+        rmt_del_encoder(ppm_encoder);
+        ppm_encoder = NULL;
+    }
+    for (int i = 0; i < output_config.num_pwm; i++) {
+        if (output_config.pwm_pins[i] >= 0) {
+            ledc_stop(LEDC_LOW_SPEED_MODE, i, 0);
+        }
+    }
+    if (output_config.sbus_pin >= 0 && uart_is_driver_installed(output_config.sbus_uart)) {
+        uart_driver_delete(output_config.sbus_uart);
+    }
+    output_config.num_pwm = 0;
+    output_config.sbus_pin = -1;
+}
+
+void CRSF_output_get_stats(crsf_output_stats_t *out)
+{
+    portENTER_CRITICAL(&output_lock);
+    *out = stats;
+    out->update_latency_avg_us = stats.updates ? latency_sum_us / stats.updates : 0;
+    portEXIT_CRITICAL(&output_lock);
+}
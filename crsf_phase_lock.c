@@ -0,0 +1,153 @@
+#include <string.h>
+#include "esp_timer.h"
+#include "crsf_internal.h"
+
+#define MIN_LEAD_US 50    // targets closer than this are skipped, the timer could not make them
+#define PHASE_GAIN_SHIFT 2 // the phase anchor moves 1/4 of the measured arrival error per frame
+#define AGE_AVG_SHIFT 3    // input_age_us averages over about 8 wake-ups
+
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+static void IRAM_ATTR wake_callback(void *arg)
+{
+    crsf_phase_lock_t *lock = arg;
+    BaseType_t woken = pdFALSE;
+
+    xTaskNotifyFromISR(lock->task, CRSF_EVENT_PHASE_WAKE, eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+#else
+static void wake_callback(void *arg)
+{
+    crsf_phase_lock_t *lock = arg;
+
+    xTaskNotify(lock->task, CRSF_EVENT_PHASE_WAKE, eSetBits);
+}
+#endif
+
+// wrap a time difference into [-interval / 2, interval / 2)
+static int64_t wrap_phase(int64_t diff_us, int64_t interval_us)
+{
+    int64_t phase = diff_us % interval_us;
+    if (phase < 0) {
+        phase += interval_us;
+    }
+    return phase >= interval_us / 2 ? phase - interval_us : phase;
+}
+
+// follow the measured arrivals with a proportional phase correction, returns false if there is nothing to follow
+static bool track_phase(crsf_phase_lock_t *lock, crsf_frame_rate_t *rate)
+{
+    if (!CRSF_get_frame_rate(rate) || CRSF_is_failsafe()) {
+        lock->locked = false;
+        return false;
+    }
+
+    if (!lock->locked) {
+        lock->anchor_us = rate->last_arrival_us;
+        lock->last_target_us = 0;
+        lock->locked = true;
+        return true;
+    }
+
+    // single arrivals jitter with the UART and rx_task scheduling, only part of the error is taken over
+    int64_t error = wrap_phase(rate->last_arrival_us - lock->anchor_us, rate->interval_us);
+    lock->anchor_us = rate->last_arrival_us - error + (error >> PHASE_GAIN_SHIFT);
+    return true;
+}
+
+static void update_stats(crsf_phase_lock_t *lock, int64_t target_us)
+{
+    int64_t now_us = esp_timer_get_time();
+    crsf_frame_rate_t rate;
+
+    lock->wakes++;
+    lock->phase_error_us = target_us ? (int32_t)(now_us - target_us) : 0;
+
+    CRSF_get_frame_rate(&rate);
+    int32_t age = (int32_t)(now_us - rate.last_arrival_us);
+    lock->input_age_us += (age - (int32_t)lock->input_age_us) >> AGE_AVG_SHIFT;
+}
+
+esp_err_t CRSF_phase_lock_init(crsf_phase_lock_t *lock, int32_t offset_us)
+{
+    memset(lock, 0, sizeof(*lock));
+    lock->offset_us = offset_us;
+    lock->task = xTaskGetCurrentTaskHandle();
+
+    esp_timer_create_args_t timer_args = {
+        .callback = wake_callback,
+        .arg = lock,
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+        .dispatch_method = ESP_TIMER_ISR,
+#else
+        .dispatch_method = ESP_TIMER_TASK,
+#endif
+        .name = "crsf_phase",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &lock->timer);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = crsf_subscribe_add(CRSF_EVENT_CHANNELS);
+    if (err != ESP_OK) {
+        esp_timer_delete(lock->timer);
+        lock->timer = NULL;
+    }
+    return err;
+}
+
+esp_err_t CRSF_phase_lock_wait(crsf_phase_lock_t *lock, TickType_t timeout)
+{
+    crsf_frame_rate_t rate;
+
+    if (!track_phase(lock, &rate)) {
+        // no estimate yet, run on the frames themselves; frames that arrived while locked are stale
+        ulTaskNotifyValueClear(NULL, CRSF_EVENT_CHANNELS);
+        if (!(CRSF_wait_event(CRSF_EVENT_CHANNELS, timeout) & CRSF_EVENT_CHANNELS)) {
+            return ESP_ERR_TIMEOUT;
+        }
+        update_stats(lock, 0);
+        return ESP_OK;
+    }
+
+    // first predicted arrival + offset far enough ahead, and at most one wake-up per frame
+    int64_t interval_us = rate.interval_us;
+    int64_t now_us = esp_timer_get_time();
+    int64_t target_us = lock->anchor_us + lock->offset_us;
+    int64_t earliest_us = now_us + MIN_LEAD_US;
+
+    if (lock->last_target_us && earliest_us < lock->last_target_us + interval_us / 2) {
+        earliest_us = lock->last_target_us + interval_us / 2;
+    }
+    if (target_us < earliest_us) {
+        target_us += (earliest_us - target_us + interval_us - 1) / interval_us * interval_us;
+    }
+    lock->last_target_us = target_us;
+
+    // a wake-up left over from a timed out wait would end this one before the target
+    ulTaskNotifyValueClear(NULL, CRSF_EVENT_PHASE_WAKE);
+    esp_err_t err = esp_timer_start_once(lock->timer, target_us - now_us);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (!(CRSF_wait_event(CRSF_EVENT_PHASE_WAKE, timeout) & CRSF_EVENT_PHASE_WAKE)) {
+        // the timer may have fired after the wait gave up
+        esp_timer_stop(lock->timer);
+        ulTaskNotifyValueClear(NULL, CRSF_EVENT_PHASE_WAKE);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    update_stats(lock, target_us);
+    return ESP_OK;
+}
+
+void CRSF_phase_lock_deinit(crsf_phase_lock_t *lock)
+{
+    if (lock->timer == NULL) {
+        return;
+    }
+    esp_timer_stop(lock->timer);
+    esp_timer_delete(lock->timer);
+    lock->timer = NULL;
+}
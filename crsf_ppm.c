@@ -0,0 +1,135 @@
+#include <string.h>
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "crsf_frame.h"
+#include "crsf_ppm.h"
+#include "crsf_attr.h"
+
+/*
+ * Channels are timed between rising edges, so the measured period is the
+ * channel pulse width whatever the polarity and separator length of the
+ * transmitter. A period longer than PPM_SYNC_MIN_US ends the frame, so a
+ * frame is only complete at the first edge after the sync gap.
+ */
+
+#define PPM_SYNC_MIN_US 3000
+#define PPM_CHANNEL_MIN_US 700
+#define PPM_CHANNEL_MAX_US 2300
+#define PPM_MIN_CHANNELS 4
+
+static gpio_num_t ppm_pin = GPIO_NUM_NC;
+static portMUX_TYPE ppm_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t ppm_waiter;
+
+// owned by the ISR
+static int64_t last_edge_us;
+static uint16_t widths[16];
+static int count = -1; // -1 until the first sync gap or after an invalid period
+
+// handed to rx_task under ppm_lock
+static uint16_t ready_widths[16];
+static int ready_count;
+static int64_t ready_us;
+static volatile bool ppm_wake;
+
+static void IRAM_ATTR ppm_isr(void *arg)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t period = now - last_edge_us;
+    last_edge_us = now;
+
+    if (period >= PPM_SYNC_MIN_US) {
+        if (count >= PPM_MIN_CHANNELS) {
+            portENTER_CRITICAL_ISR(&ppm_lock);
+            memcpy(ready_widths, widths, count * sizeof(widths[0]));
+            ready_count = count;
+            ready_us = now - period; // edge that ended the last channel
+            portEXIT_CRITICAL_ISR(&ppm_lock);
+
+            BaseType_t woken = pdFALSE;
+            if (ppm_waiter != NULL) {
+                vTaskNotifyGiveFromISR(ppm_waiter, &woken);
+            }
+            portYIELD_FROM_ISR(woken);
+        }
+        count = 0;
+    } else if (count >= 0) {
+        if (period < PPM_CHANNEL_MIN_US || period > PPM_CHANNEL_MAX_US || count == 16) {
+            count = -1; // noise, drop the frame
+        } else {
+            widths[count++] = period;
+        }
+    }
+}
+
+esp_err_t crsf_ppm_start(gpio_num_t rx_pin)
+{
+    count = -1;
+    ready_count = 0;
+    ppm_wake = false;
+
+    gpio_config_t io_config = {
+        .pin_bit_mask = 1ULL << rx_pin,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_ENABLE,
+        .intr_type = GPIO_INTR_POSEDGE,
+    };
+    esp_err_t err = gpio_config(&io_config);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        return err;
+    }
+    err = gpio_isr_handler_add(rx_pin, ppm_isr, NULL);
+    if (err == ESP_OK) {
+        ppm_pin = rx_pin;
+    }
+    return err;
+}
+
+void crsf_ppm_stop(void)
+{
+    gpio_isr_handler_remove(ppm_pin);
+    gpio_set_intr_type(ppm_pin, GPIO_INTR_DISABLE);
+    ppm_pin = GPIO_NUM_NC;
+    ppm_waiter = NULL;
+}
+
+int crsf_ppm_receive(uint16_t *values, int64_t *arrival_us)
+{
+    ppm_waiter = xTaskGetCurrentTaskHandle();
+
+    for (;;) {
+        if (ppm_wake) {
+            ppm_wake = false;
+            return 0;
+        }
+
+        uint16_t frame[16];
+        portENTER_CRITICAL(&ppm_lock);
+        int n = ready_count;
+        memcpy(frame, ready_widths, n * sizeof(frame[0]));
+        *arrival_us = ready_us;
+        ready_count = 0;
+        portEXIT_CRITICAL(&ppm_lock);
+
+        if (n > 0) {
+            for (int ch = 0; ch < 16; ch++) {
+                values[ch] = ch < n ? crsf_us_to_channel(frame[ch]) : CRSF_CHANNEL_VALUE_MID;
+            }
+            return n;
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+void crsf_ppm_wake(void)
+{
+    ppm_wake = true;
+    if (ppm_waiter != NULL) {
+        xTaskNotifyGive(ppm_waiter);
+    }
+}
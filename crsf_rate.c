@@ -0,0 +1,86 @@
+#include <string.h>
+#include "crsf_rate.h"
+#include "crsf_attr.h"
+
+#define EWMA_SHIFT 3      // alpha = 1/8 for the interval
+#define JITTER_SHIFT 4    // alpha = 1/16 for the jitter
+#define MAX_MULTIPLE 4    // up to 3 consecutive missing frames are recognised as such
+
+// |a - b| within 25% of ref
+static inline CRSF_IRAM_ATTR bool close_to(uint32_t a, uint32_t b, uint32_t ref)
+{
+    uint32_t diff = a > b ? a - b : b - a;
+    return diff <= ref / 4;
+}
+
+static CRSF_IRAM_ATTR void track_candidate(crsf_rate_estimator_t *est, uint32_t sample_q4)
+{
+    if (est->candidate_count > 0 && close_to(sample_q4, est->candidate_q4, est->candidate_q4)) {
+        est->candidate_q4 += ((int32_t)sample_q4 - (int32_t)est->candidate_q4) / 4;
+        est->candidate_count++;
+    } else {
+        est->candidate_q4 = sample_q4;
+        est->candidate_count = 1;
+    }
+}
+
+void crsf_rate_init(crsf_rate_estimator_t *est)
+{
+    memset(est, 0, sizeof(*est));
+}
+
+CRSF_IRAM_ATTR bool crsf_rate_update(crsf_rate_estimator_t *est, int64_t arrival_us)
+{
+    int64_t last = est->last_arrival_us;
+    est->last_arrival_us = arrival_us;
+
+    if (last == 0 || arrival_us <= last) {
+        return false;
+    }
+    int64_t delta = arrival_us - last;
+    if (delta > CRSF_RATE_RESET_GAP_US) {
+        // link was lost, the next rate may be anything
+        est->candidate_count = 0;
+        return false;
+    }
+    uint32_t sample_q4 = (uint32_t)delta << 4;
+
+    if (est->interval_q4 == 0) {
+        track_candidate(est, sample_q4);
+        if (est->candidate_count < CRSF_RATE_CHANGE_FRAMES / 2) {
+            return false;
+        }
+        est->interval_q4 = est->candidate_q4;
+        est->candidate_count = 0;
+        return true;
+    }
+
+    // lost frames and telemetry slots stretch the interval to an integer multiple
+    uint32_t multiple = (sample_q4 + est->interval_q4 / 2) / est->interval_q4;
+    if (multiple >= 1 && multiple <= MAX_MULTIPLE &&
+        close_to(sample_q4 / multiple, est->interval_q4, est->interval_q4 / 2)) {
+        uint32_t per_frame_q4 = sample_q4 / multiple;
+        int32_t error = (int32_t)per_frame_q4 - (int32_t)est->interval_q4;
+        uint32_t abs_error = error < 0 ? -error : error;
+
+        est->interval_q4 += error >> EWMA_SHIFT;
+        est->jitter_q4 += ((int32_t)abs_error - (int32_t)est->jitter_q4) >> JITTER_SHIFT;
+        if (multiple == 1) {
+            est->candidate_count = 0;
+            return false;
+        }
+    }
+
+    // a slower rate also looks like missed frames, so multiples count towards a candidate as well
+    track_candidate(est, sample_q4);
+    if (est->candidate_count < CRSF_RATE_CHANGE_FRAMES ||
+        close_to(est->candidate_q4, est->interval_q4, est->interval_q4 / 2)) {
+        return false;
+    }
+
+    est->interval_q4 = est->candidate_q4;
+    est->jitter_q4 = 0;
+    est->candidate_count = 0;
+    est->rate_changes++;
+    return true;
+}
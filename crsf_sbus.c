@@ -0,0 +1,76 @@
+#include <string.h>
+#include "crsf_sbus.h"
+#include "crsf_frame.h"
+#include "crsf_attr.h"
+
+CRSF_IRAM_ATTR void crsf_sbus_build_frame(uint8_t *frame, const uint16_t *values, uint8_t flags)
+{
+    frame[0] = CRSF_SBUS_HEADER;
+    crsf_pack_channels(values, &frame[1]);
+    frame[23] = flags;
+    frame[24] = CRSF_SBUS_FOOTER;
+}
+
+void crsf_sbus_parser_init(crsf_sbus_parser_t *parser)
+{
+    memset(parser, 0, sizeof(*parser));
+}
+
+static inline bool sbus_footer_valid(uint8_t footer)
+{
+    return footer == CRSF_SBUS_FOOTER || (footer & 0x0F) == 0x04;
+}
+
+// drop bytes from the front of the buffer up to the next possible header
+static void sbus_resync(crsf_sbus_parser_t *parser)
+{
+    uint8_t skip = 1;
+    while (skip < parser->pos && parser->buf[skip] != CRSF_SBUS_HEADER) {
+        skip++;
+    }
+    memmove(parser->buf, &parser->buf[skip], parser->pos - skip);
+    parser->pos -= skip;
+    parser->dropped_bytes += skip;
+}
+
+CRSF_IRAM_ATTR size_t crsf_sbus_parser_feed(crsf_sbus_parser_t *parser, const uint8_t *data, size_t len, crsf_sbus_handler_t handler, void *ctx)
+{
+    size_t found = 0;
+
+    while (len > 0) {
+        if (parser->pos == 0) {
+            // skip everything up to a header byte in one pass
+            const uint8_t *header = memchr(data, CRSF_SBUS_HEADER, len);
+            size_t skip = header ? (size_t)(header - data) : len;
+            parser->dropped_bytes += skip;
+            data += skip;
+            len -= skip;
+            if (len == 0) {
+                break;
+            }
+        }
+
+        size_t n = CRSF_SBUS_FRAME_SIZE - parser->pos;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(&parser->buf[parser->pos], data, n);
+        parser->pos += n;
+        data += n;
+        len -= n;
+
+        if (parser->pos < CRSF_SBUS_FRAME_SIZE) {
+            break;
+        }
+        if (sbus_footer_valid(parser->buf[CRSF_SBUS_FRAME_SIZE - 1])) {
+            parser->frames++;
+            parser->pos = 0;
+            handler(&parser->buf[1], parser->buf[23], ctx);
+            found++;
+        } else {
+            sbus_resync(parser);
+        }
+    }
+
+    return found;
+}
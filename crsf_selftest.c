@@ -0,0 +1,145 @@
+#include <inttypes.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "crsf_internal.h"
+#include "crsf_uart.h"
+
+// rates accepted by ELRS receivers, plus the 420000 default of this component
+static const uint32_t default_baud_rates[] = { 115200, 400000, 416666, 420000, 921600, 1870000, 3750000 };
+
+#define DRAIN_TIME_MS 20 // time for the last frames to arrive after the TX buffer is empty
+
+// written by rx_task, read by the test task once the TX side is idle
+static volatile bool selftest_running = false;
+static volatile uint32_t selftest_received;
+static volatile uint32_t selftest_lost;
+static uint32_t selftest_expected;
+
+void crsf_selftest_frame(const uint8_t *payload, uint8_t payload_length)
+{
+    if (!selftest_running || payload_length < sizeof(uint32_t)) {
+        return;
+    }
+
+    uint32_t seq = payload[0] | (payload[1] << 8) | (payload[2] << 16) | ((uint32_t)payload[3] << 24);
+    if (seq > selftest_expected) {
+        selftest_lost += seq - selftest_expected;
+    }
+    selftest_expected = seq + 1;
+    selftest_received++;
+}
+
+static uint32_t rx_task_run_time(void)
+{
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    TaskStatus_t status;
+    vTaskGetInfo(crsf_get_rx_task(), &status, pdFALSE, eInvalid);
+    return status.ulRunTimeCounter;
+#else
+    return 0;
+#endif
+}
+
+static void run_baud_rate(uint32_t baud_rate, uint32_t duration_ms, crsf_selftest_result_t *result)
+{
+    const crsf_parser_t *parser = crsf_get_rx_parser();
+    uint8_t payload[CRSF_SELFTEST_PAYLOAD_SIZE];
+    uint8_t frame[CRSF_MAX_FRAME_SIZE];
+
+    memset(result, 0, sizeof(*result));
+    result->baud_rate = baud_rate;
+
+    crsf_uart_wait_tx_done(portMAX_DELAY);
+    crsf_uart_set_baudrate(baud_rate);
+    crsf_uart_flush_input();
+    vTaskDelay(pdMS_TO_TICKS(DRAIN_TIME_MS));
+
+    uint32_t crc_errors = parser->crc_errors;
+    uint32_t dropped_bytes = parser->dropped_bytes;
+    selftest_received = 0;
+    selftest_lost = 0;
+    selftest_expected = 0;
+    selftest_running = true;
+
+    uint32_t run_time = rx_task_run_time();
+    int64_t start_us = esp_timer_get_time();
+    int64_t end_us = start_us + duration_ms * 1000LL;
+
+    memset(payload, 0xA5, sizeof(payload));
+    // test frames are not telemetry and bypass the budget; a frame the transmitter refuses
+    // is sent again with the same sequence number once the queue drained a little, so this
+    // runs at line rate without starving lower priority tasks
+    while (esp_timer_get_time() < end_us) {
+        uint32_t seq = result->frames_sent;
+        payload[0] = seq & 0xFF;
+        payload[1] = (seq >> 8) & 0xFF;
+        payload[2] = (seq >> 16) & 0xFF;
+        payload[3] = (seq >> 24) & 0xFF;
+        size_t frame_length = crsf_build_frame(frame, CRSF_DEST_FC, CRSF_SELFTEST_TYPE, payload, sizeof(payload));
+        if (crsf_send_frame(frame, frame_length)) {
+            result->frames_sent++;
+        } else {
+            vTaskDelay(1);
+        }
+    }
+
+    crsf_uart_wait_tx_done(portMAX_DELAY);
+    vTaskDelay(pdMS_TO_TICKS(DRAIN_TIME_MS));
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    selftest_running = false;
+
+    result->frames_received = selftest_received;
+    // frames missing at the end of the run never show up as a sequence gap
+    result->frames_lost = selftest_lost + (result->frames_sent - selftest_expected);
+    result->crc_errors = parser->crc_errors - crc_errors;
+    result->dropped_bytes = parser->dropped_bytes - dropped_bytes;
+    result->frames_per_second = (uint64_t)result->frames_received * 1000000 / elapsed_us;
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    // the run time counter counts microseconds when it is driven by esp_timer
+    result->rx_task_cpu_percent = (uint64_t)(rx_task_run_time() - run_time) * 100 / elapsed_us;
+#else
+    (void)run_time;
+    result->rx_task_cpu_percent = -1;
+#endif
+}
+
+int CRSF_selftest(const crsf_selftest_config_t *config, crsf_selftest_result_t *results, size_t max_results)
+{
+    if (crsf_get_rx_task() == NULL || crsf_get_config()->input != CRSF_INPUT_CRSF) {
+        return -1;
+    }
+
+    uart_port_t uart = crsf_get_config()->uart_num;
+    const uint32_t *baud_rates = config->baud_rates ? config->baud_rates : default_baud_rates;
+    size_t num_baud_rates = config->baud_rates ? config->num_baud_rates
+                                               : sizeof(default_baud_rates) / sizeof(default_baud_rates[0]);
+    size_t count = 0;
+
+    if (config->internal_loopback) {
+        uart_set_loop_back(uart, true);
+    }
+
+    for (size_t i = 0; i < num_baud_rates && count < max_results; i++) {
+        run_baud_rate(baud_rates[i], config->duration_ms, &results[count++]);
+    }
+
+    if (config->internal_loopback) {
+        uart_set_loop_back(uart, false);
+    }
+    crsf_uart_set_baudrate(crsf_get_config()->baud_rate);
+    crsf_uart_flush_input();
+
+    return count;
+}
+
+void CRSF_selftest_print_results(const crsf_selftest_result_t *results, size_t num_results)
+{
+    for (size_t i = 0; i < num_results; i++) {
+        const crsf_selftest_result_t *r = &results[i];
+        bool pass = r->frames_sent > 0 && r->frames_lost == 0 && r->crc_errors == 0;
+        ESP_LOGI(CRSF_TAG, "%7" PRIu32 " baud: %s sent %" PRIu32 " received %" PRIu32 " lost %" PRIu32
+                 " crc %" PRIu32 " dropped %" PRIu32 " bytes, %" PRIu32 " frames/s, rx_task cpu %d%%",
+                 r->baud_rate, pass ? "PASS" : "FAIL", r->frames_sent, r->frames_received, r->frames_lost,
+                 r->crc_errors, r->dropped_bytes, r->frames_per_second, r->rx_task_cpu_percent);
+    }
+}
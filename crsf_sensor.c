@@ -0,0 +1,141 @@
+#include <string.h>
+#include "esp_timer.h"
+#include "crsf_frame.h"
+#include "crsf_internal.h"
+
+/*
+ * Telemetry scheduler. Right after a channels frame the receiver has just
+ * used its UART slot towards us and is ready to take telemetry, so rx_task
+ * fills and sends at most one frame per channels frame: the most overdue
+ * source whose interval has elapsed. Fill callbacks run outside the lock,
+ * a busy flag keeps CRSF_sensor_unregister from returning while one runs.
+ */
+
+typedef struct
+{
+    crsf_sensor_source_t source;
+    uint32_t interval_us;
+    int64_t next_due_us;
+    bool busy;
+} sensor_slot_t;
+
+volatile bool crsf_sensor_active = false;
+
+static portMUX_TYPE sensor_lock = portMUX_INITIALIZER_UNLOCKED;
+static sensor_slot_t sensors[CONFIG_CRSF_SENSOR_MAX_SOURCES];
+
+// must be called with sensor_lock held, returns the index of the most overdue source or -1
+static int most_overdue(int64_t now_us, uint32_t skip_mask)
+{
+    int best = -1;
+    for (int i = 0; i < CONFIG_CRSF_SENSOR_MAX_SOURCES; i++) {
+        if (sensors[i].source.fill == NULL || (skip_mask & (1u << i)) || sensors[i].next_due_us > now_us) {
+            continue;
+        }
+        if (best < 0 || sensors[i].next_due_us < sensors[best].next_due_us) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+void crsf_sensor_slot(int64_t now_us)
+{
+    uint32_t tried = 0;
+
+    // sources with nothing new give the slot to the next one
+    for (;;) {
+        portENTER_CRITICAL(&sensor_lock);
+        int i = most_overdue(now_us, tried);
+        crsf_sensor_source_t source;
+        if (i >= 0) {
+            source = sensors[i].source;
+            sensors[i].busy = true;
+            // no catch-up bursts after a gap, just keep the interval from now on
+            sensors[i].next_due_us += sensors[i].interval_us;
+            if (sensors[i].next_due_us <= now_us) {
+                sensors[i].next_due_us = now_us + sensors[i].interval_us;
+            }
+        }
+        portEXIT_CRITICAL(&sensor_lock);
+
+        if (i < 0) {
+            return;
+        }
+        tried |= 1u << i;
+
+        uint8_t frame[CRSF_MAX_FRAME_SIZE];
+        size_t length = source.fill(&frame[3], CRSF_MAX_PAYLOAD_SIZE, source.ctx);
+        if (length > 0) {
+            length = crsf_finish_frame(frame, source.dest, source.type, length);
+        }
+
+        portENTER_CRITICAL(&sensor_lock);
+        sensors[i].busy = false;
+        portEXIT_CRITICAL(&sensor_lock);
+
+        if (length > 0) {
+            crsf_send_telemetry(frame, length, source.type);
+            return;
+        }
+    }
+}
+
+esp_err_t CRSF_sensor_register(const crsf_sensor_source_t *source, int *id)
+{
+    if (source->fill == NULL || source->rate_hz == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = ESP_ERR_NO_MEM;
+    portENTER_CRITICAL(&sensor_lock);
+    for (int i = 0; i < CONFIG_CRSF_SENSOR_MAX_SOURCES; i++) {
+        if (sensors[i].source.fill == NULL && !sensors[i].busy) {
+            sensors[i].source = *source;
+            sensors[i].interval_us = 1000000 / source->rate_hz;
+            sensors[i].next_due_us = 0; // due in the next slot
+            *id = i;
+            crsf_sensor_active = true;
+            err = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&sensor_lock);
+
+    return err;
+}
+
+esp_err_t CRSF_sensor_unregister(int id)
+{
+    if (id < 0 || id >= CONFIG_CRSF_SENSOR_MAX_SOURCES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&sensor_lock);
+    sensors[id].source.fill = NULL;
+    bool any = false;
+    for (int i = 0; i < CONFIG_CRSF_SENSOR_MAX_SOURCES; i++) {
+        any |= sensors[i].source.fill != NULL;
+    }
+    crsf_sensor_active = any;
+    // the callback may be running in rx_task right now; if this is rx_task, it is the caller
+    bool from_fill = xTaskGetCurrentTaskHandle() == crsf_get_rx_task();
+    while (sensors[id].busy && !from_fill) {
+        portEXIT_CRITICAL(&sensor_lock);
+        vTaskDelay(1);
+        portENTER_CRITICAL(&sensor_lock);
+    }
+    portEXIT_CRITICAL(&sensor_lock);
+
+    return ESP_OK;
+}
+
+void crsf_sensor_deinit(void)
+{
+    portENTER_CRITICAL(&sensor_lock);
+    for (int i = 0; i < CONFIG_CRSF_SENSOR_MAX_SOURCES; i++) {
+        sensors[i].source.fill = NULL;
+    }
+    crsf_sensor_active = false;
+    portEXIT_CRITICAL(&sensor_lock);
+}
@@ -0,0 +1,54 @@
+#include <string.h>
+#include "crsf_txq.h"
+
+_Static_assert((CRSF_TXQ_SLOTS & (CRSF_TXQ_SLOTS - 1)) == 0, "CRSF_TXQ_SLOTS must be a power of two");
+
+#define SLOT_MASK (CRSF_TXQ_SLOTS - 1)
+
+void crsf_txq_init(crsf_txq_t *queue)
+{
+    memset(queue, 0, sizeof(*queue));
+    // a slot is free for position p when its sequence equals p
+    for (uint32_t i = 0; i < CRSF_TXQ_SLOTS; i++) {
+        queue->slots[i].seq = i;
+    }
+}
+
+bool crsf_txq_push(crsf_txq_t *queue, const uint8_t *frame, size_t length)
+{
+    if (length > CRSF_MAX_FRAME_SIZE) {
+        return false;
+    }
+
+    uint32_t pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    crsf_txq_slot_t *slot;
+
+    for (;;) {
+        slot = &queue->slots[pos & SLOT_MASK];
+        int32_t diff = (int32_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+        if (diff == 0) {
+            // on failure pos is reloaded with the current head
+            if (__atomic_compare_exchange_n(&queue->head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // the slot still holds a frame from the previous round
+            __atomic_fetch_add(&queue->dropped, 1, __ATOMIC_RELAXED);
+            return false;
+        } else {
+            pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    memcpy(slot->frame, frame, length);
+    slot->length = length;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+    // the consumer may already have taken this and later frames, then there is nothing to record
+    int32_t depth = (int32_t)(pos + 1 - __atomic_load_n(&queue->tail, __ATOMIC_RELAXED));
+    uint32_t max_depth = __atomic_load_n(&queue->max_depth, __ATOMIC_RELAXED);
+    while (depth > (int32_t)max_depth &&
+           !__atomic_compare_exchange_n(&queue->max_depth, &max_depth, depth, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    return true;
+}
@@ -0,0 +1,218 @@
+#include "driver/uart.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "crsf_uart.h"
+#include "crsf_internal.h"
+#include "crsf_txq.h"
+
+/*
+ * UART driver backend: rx_task waits on the driver's event queue. Senders
+ * queue whole frames lock-free (crsf_txq) and wake tx_task, the only task
+ * that writes to the UART. It waits until each frame is in the hardware FIFO,
+ * so no sender ever waits for another one or for the transmitter, and the
+ * frame queue replaces the driver's TX ring.
+ */
+
+static uart_port_t uart_num;
+static QueueHandle_t uart_queue;
+static size_t rx_pending; // announced by UART_DATA events, not read yet
+static crsf_txq_t tx_queue;
+static TaskHandle_t tx_task_handle;
+static SemaphoreHandle_t tx_task_exited;
+static volatile bool tx_task_stop;
+static size_t driver_heap; // taken by uart_driver_install: driver state, RX ring, event queue
+
+// an event type the driver never sends, used to wake rx_task
+#define WAKE_EVENT UART_EVENT_MAX
+
+static void tx_task(void *arg)
+{
+    while (!tx_task_stop) {
+        const uint8_t *frame;
+        size_t length = crsf_txq_peek(&tx_queue, &frame);
+        if (length == 0) {
+            // senders notify after queueing, a frame queued since the peek is not missed
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        uart_write_bytes(uart_num, frame, length);
+        crsf_txq_pop(&tx_queue);
+    }
+    xSemaphoreGive(tx_task_exited);
+    vTaskDelete(NULL);
+}
+
+esp_err_t crsf_uart_start(const crsf_config_t *config)
+{
+    // Begin UART communication with RX
+    bool sbus = config->input == CRSF_INPUT_SBUS;
+    uart_config_t uart_config = {
+        .baud_rate = config->baud_rate,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = sbus ? UART_PARITY_EVEN : UART_PARITY_DISABLE,
+        .stop_bits = sbus ? UART_STOP_BITS_2 : UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE
+    };
+    esp_err_t err = uart_param_config(config->uart_num, &uart_config);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = uart_set_pin(config->uart_num, config->tx_pin, config->rx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    if (err != ESP_OK) {
+        return err;
+    }
+    // also clears the inversion left behind by an earlier SBUS configuration
+    err = uart_set_line_inverse(config->uart_num, sbus ? UART_SIGNAL_RXD_INV : UART_SIGNAL_INV_DISABLE);
+    if (err != ESP_OK) {
+        return err;
+    }
+    // no TX ring, tx_task writes straight into the FIFO
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    err = uart_driver_install(config->uart_num, CRSF_UART_RX_RING_SIZE, 0, CONFIG_CRSF_UART_QUEUE_SIZE, &uart_queue, 0);
+    if (err != ESP_OK) {
+        return err;
+    }
+    // other tasks may allocate meanwhile, good enough for a report
+    size_t free_after = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    driver_heap = free_before > free_after ? free_before - free_after : 0;
+    uart_num = config->uart_num;
+
+    if (tx_task_exited == NULL) {
+        tx_task_exited = xSemaphoreCreateBinary();
+    }
+    crsf_txq_init(&tx_queue);
+    tx_task_stop = false;
+    if (tx_task_exited == NULL ||
+        xTaskCreate(tx_task, "crsf_tx_task", CONFIG_CRSF_TX_TASK_STACK_SIZE, NULL, CONFIG_CRSF_TASK_PRIORITY,
+                    &tx_task_handle) != pdPASS) {
+        tx_task_handle = NULL;
+        uart_driver_delete(uart_num);
+        uart_queue = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void crsf_uart_stop(void)
+{
+    // frames still queued are discarded
+    tx_task_stop = true;
+    xTaskNotifyGive(tx_task_handle);
+    xSemaphoreTake(tx_task_exited, portMAX_DELAY);
+    tx_task_handle = NULL;
+
+    uart_driver_delete(uart_num);
+    uart_queue = NULL;
+    rx_pending = 0;
+}
+
+int crsf_uart_receive(uint8_t *data, size_t max_length)
+{
+    uart_event_t event;
+
+    for (;;) {
+        // an event can announce more bytes than the read buffer holds
+        if (rx_pending > 0) {
+            int len = uart_read_bytes(uart_num, data, rx_pending < max_length ? rx_pending : max_length, 0);
+            if (len > 0) {
+                rx_pending -= len;
+                return len;
+            }
+            rx_pending = 0; // flushed meanwhile
+        }
+
+        // Waiting for UART event.
+        if (!xQueueReceive(uart_queue, (void *)&event, (TickType_t)portMAX_DELAY)) {
+            continue;
+        }
+
+        switch ((int)event.type) {
+            case UART_DATA:
+                if (crsf_latency_active) {
+                    crsf_latency_rx_wake(esp_timer_get_time(), event.size);
+                }
+                rx_pending += event.size;
+                break;
+
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                rx_pending = 0;
+                uart_flush_input(uart_num);
+                xQueueReset(uart_queue);
+                return -1;
+
+            case WAKE_EVENT:
+                return 0;
+
+            default:
+                break;
+        }
+    }
+}
+
+void crsf_uart_wake(void)
+{
+    uart_event_t wake = { .type = WAKE_EVENT };
+    xQueueSendToFront(uart_queue, &wake, portMAX_DELAY);
+}
+
+bool crsf_uart_write(const uint8_t *data, size_t length)
+{
+    TaskHandle_t task = tx_task_handle;
+
+    if (task == NULL || !crsf_txq_push(&tx_queue, data, length)) {
+        return false;
+    }
+    xTaskNotifyGive(task);
+    return true;
+}
+
+void crsf_uart_get_tx_stats(crsf_tx_stats_t *stats)
+{
+    stats->frames = __atomic_load_n(&tx_queue.frames, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&tx_queue.dropped, __ATOMIC_RELAXED);
+    stats->max_depth = __atomic_load_n(&tx_queue.max_depth, __ATOMIC_RELAXED);
+}
+
+TaskHandle_t crsf_uart_get_tx_task(void)
+{
+    return tx_task_handle;
+}
+
+size_t crsf_uart_memory_size(void)
+{
+    return driver_heap + sizeof(tx_queue) + sizeof(StaticTask_t) + sizeof(StaticSemaphore_t);
+}
+
+void crsf_uart_wait_tx_done(TickType_t timeout)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    // tx_task takes a frame off the queue once it is in the FIFO
+    while (crsf_txq_pending(&tx_queue) != 0) {
+        if (timeout != portMAX_DELAY && xTaskGetTickCount() - start >= timeout) {
+            return;
+        }
+        vTaskDelay(1);
+    }
+    if (timeout != portMAX_DELAY) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        timeout = elapsed < timeout ? timeout - elapsed : 0;
+    }
+    uart_wait_tx_done(uart_num, timeout);
+}
+
+void crsf_uart_flush_input(void)
+{
+    uart_flush_input(uart_num);
+}
+
+esp_err_t crsf_uart_set_baudrate(uint32_t baud_rate)
+{
+    return uart_set_baudrate(uart_num, baud_rate);
+}
+
+esp_err_t crsf_uart_set_pins(uint8_t tx_pin, uint8_t rx_pin)
+{
+    return uart_set_pin(uart_num, tx_pin, rx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+}
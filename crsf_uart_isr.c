@@ -0,0 +1,299 @@
+#include <string.h>
+#include "driver/uart.h"
+#include "hal/uart_ll.h"
+#include "soc/uart_periph.h"
+#include "esp_intr_alloc.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "crsf_uart.h"
+#include "crsf_internal.h"
+#include "crsf_attr.h"
+#include "crsf_txq.h"
+
+/*
+ * Direct interrupt backend: the ISR moves received bytes from the FIFO into a
+ * byte ring and wakes rx_task with a direct-to-task notification, and feeds
+ * the TX FIFO from the frame queue, without the UART driver's event queue and
+ * ring buffers in between.
+ *
+ * RX ring: single producer (ISR), single consumer (rx_task), lock-free.
+ * Indices run from 0 to RING_SIZE - 1, one slot stays free to tell full from empty.
+ * TX queue: any task queues whole frames lock-free (crsf_txq), the ISR is the
+ * single consumer. No task ever writes to the UART, so a preempted sender
+ * cannot hold up the others and rx_task never waits for the transmitter.
+ */
+
+#define RING_SIZE CONFIG_CRSF_RX_BUF_SIZE
+#define RX_FULL_THRESHOLD 96 // of the 128 byte hardware FIFO
+#define RX_TIMEOUT_SYMBOLS 3 // idle byte times that end a burst, CRSF frames are sent back to back
+#define TX_EMPTY_THRESHOLD 16
+
+#define RX_INTR (UART_INTR_RXFIFO_FULL | UART_INTR_RXFIFO_TOUT)
+
+typedef struct
+{
+    uint8_t buf[RING_SIZE];
+    volatile uint32_t head; // written by the producer
+    volatile uint32_t tail; // written by the consumer
+} crsf_ring_t;
+
+static uart_port_t uart_num;
+static uart_dev_t *hw;
+static intr_handle_t intr_handle;
+static crsf_ring_t rx_ring;
+static crsf_txq_t tx_queue;
+static uint8_t tx_offset; // bytes of the oldest queued frame already in the FIFO
+static portMUX_TYPE tx_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t rx_waiter;
+static volatile bool rx_overflow;
+static volatile bool rx_flush;
+static volatile bool rx_wake;
+static size_t intr_heap; // taken by esp_intr_alloc
+
+static inline uint32_t ring_used(uint32_t head, uint32_t tail)
+{
+    return head >= tail ? head - tail : RING_SIZE - tail + head;
+}
+
+static void IRAM_ATTR isr_receive(void)
+{
+    uint32_t head = rx_ring.head;
+    uint32_t tail = __atomic_load_n(&rx_ring.tail, __ATOMIC_ACQUIRE);
+    uint32_t len = uart_ll_get_rxfifo_len(hw);
+    uint32_t space = RING_SIZE - 1 - ring_used(head, tail);
+
+    if (len > space) {
+        // rx_task fell behind, the stream is broken anyway
+        rx_overflow = true;
+        uart_ll_rxfifo_rst(hw);
+        return;
+    }
+    while (len > 0) {
+        uint32_t chunk = RING_SIZE - head < len ? RING_SIZE - head : len;
+        uart_ll_read_rxfifo(hw, &rx_ring.buf[head], chunk);
+        head = head + chunk == RING_SIZE ? 0 : head + chunk;
+        len -= chunk;
+    }
+    __atomic_store_n(&rx_ring.head, head, __ATOMIC_RELEASE);
+}
+
+static void IRAM_ATTR isr_transmit(void)
+{
+    uint32_t space = uart_ll_get_txfifo_len(hw);
+    const uint8_t *frame;
+    size_t length = 0;
+
+    // frames may be split across FIFO refills, the slot is released once all of it is in the FIFO
+    while (space > 0 && (length = crsf_txq_peek(&tx_queue, &frame)) > 0) {
+        uint32_t chunk = length - tx_offset < space ? length - tx_offset : space;
+        uart_ll_write_txfifo(hw, &frame[tx_offset], chunk);
+        tx_offset += chunk;
+        space -= chunk;
+        if (tx_offset == length) {
+            crsf_txq_pop(&tx_queue);
+            tx_offset = 0;
+        }
+    }
+
+    if (length == 0) {
+        // under tx_lock: a sender queueing right now enables the interrupt after this
+        portENTER_CRITICAL_ISR(&tx_lock);
+        if (crsf_txq_peek(&tx_queue, &frame) == 0) {
+            uart_ll_disable_intr_mask(hw, UART_INTR_TXFIFO_EMPTY);
+        }
+        portEXIT_CRITICAL_ISR(&tx_lock);
+    }
+}
+
+static void IRAM_ATTR uart_isr(void *arg)
+{
+    uint32_t status = uart_ll_get_intsts_mask(hw);
+    BaseType_t woken = pdFALSE;
+
+    if (status & (RX_INTR | UART_INTR_RXFIFO_OVF)) {
+        if (status & UART_INTR_RXFIFO_OVF) {
+            rx_overflow = true;
+            uart_ll_rxfifo_rst(hw);
+        } else {
+            isr_receive();
+        }
+        uart_ll_clr_intsts_mask(hw, RX_INTR | UART_INTR_RXFIFO_OVF);
+        if (rx_waiter != NULL) {
+            vTaskNotifyGiveFromISR(rx_waiter, &woken);
+        }
+    }
+
+    if (status & UART_INTR_TXFIFO_EMPTY) {
+        isr_transmit();
+        uart_ll_clr_intsts_mask(hw, UART_INTR_TXFIFO_EMPTY);
+    }
+
+    portYIELD_FROM_ISR(woken);
+}
+
+esp_err_t crsf_uart_start(const crsf_config_t *config)
+{
+    bool sbus = config->input == CRSF_INPUT_SBUS;
+    uart_config_t uart_config = {
+        .baud_rate = config->baud_rate,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = sbus ? UART_PARITY_EVEN : UART_PARITY_DISABLE,
+        .stop_bits = sbus ? UART_STOP_BITS_2 : UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE
+    };
+    esp_err_t err = uart_param_config(config->uart_num, &uart_config);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = uart_set_pin(config->uart_num, config->tx_pin, config->rx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    if (err != ESP_OK) {
+        return err;
+    }
+    // also clears the inversion left behind by an earlier SBUS configuration
+    err = uart_set_line_inverse(config->uart_num, sbus ? UART_SIGNAL_RXD_INV : UART_SIGNAL_INV_DISABLE);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    uart_num = config->uart_num;
+    hw = UART_LL_GET_HW(uart_num);
+    rx_ring.head = rx_ring.tail = 0;
+    crsf_txq_init(&tx_queue);
+    tx_offset = 0;
+    rx_overflow = rx_flush = rx_wake = false;
+
+    uart_ll_disable_intr_mask(hw, UART_LL_INTR_MASK);
+    uart_ll_clr_intsts_mask(hw, UART_LL_INTR_MASK);
+    uart_ll_rxfifo_rst(hw);
+    uart_ll_txfifo_rst(hw);
+    uart_ll_set_rxfifo_full_thr(hw, RX_FULL_THRESHOLD);
+    uart_ll_set_rx_tout(hw, RX_TIMEOUT_SYMBOLS);
+    uart_ll_set_txfifo_empty_thr(hw, TX_EMPTY_THRESHOLD);
+
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    err = esp_intr_alloc(uart_periph_signal[uart_num].irq, ESP_INTR_FLAG_IRAM, uart_isr, NULL, &intr_handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    size_t free_after = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    intr_heap = free_before > free_after ? free_before - free_after : 0;
+    uart_ll_ena_intr_mask(hw, RX_INTR | UART_INTR_RXFIFO_OVF);
+    return ESP_OK;
+}
+
+void crsf_uart_stop(void)
+{
+    uart_ll_disable_intr_mask(hw, UART_LL_INTR_MASK);
+    esp_intr_free(intr_handle);
+    intr_handle = NULL;
+    rx_waiter = NULL;
+}
+
+CRSF_IRAM_ATTR int crsf_uart_receive(uint8_t *data, size_t max_length)
+{
+    rx_waiter = xTaskGetCurrentTaskHandle();
+
+    for (;;) {
+        uint32_t tail = rx_ring.tail;
+        uint32_t head = __atomic_load_n(&rx_ring.head, __ATOMIC_ACQUIRE);
+
+        if (rx_overflow || rx_flush) {
+            bool overflow = rx_overflow;
+            rx_overflow = rx_flush = false;
+            __atomic_store_n(&rx_ring.tail, head, __ATOMIC_RELEASE);
+            if (overflow) {
+                return -1;
+            }
+            continue;
+        }
+
+        uint32_t used = ring_used(head, tail);
+        if (used > 0) {
+            size_t len = used < max_length ? used : max_length;
+            size_t first = RING_SIZE - tail < len ? RING_SIZE - tail : len;
+
+            if (crsf_latency_active) {
+                crsf_latency_rx_wake(esp_timer_get_time(), used);
+            }
+            memcpy(data, &rx_ring.buf[tail], first);
+            memcpy(data + first, rx_ring.buf, len - first);
+            tail += len;
+            __atomic_store_n(&rx_ring.tail, tail >= RING_SIZE ? tail - RING_SIZE : tail, __ATOMIC_RELEASE);
+            return len;
+        }
+
+        if (rx_wake) {
+            rx_wake = false;
+            return 0;
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+void crsf_uart_wake(void)
+{
+    rx_wake = true;
+    if (rx_waiter != NULL) {
+        xTaskNotifyGive(rx_waiter);
+    }
+}
+
+bool crsf_uart_write(const uint8_t *data, size_t length)
+{
+    if (!crsf_txq_push(&tx_queue, data, length)) {
+        return false;
+    }
+    // the ISR disables the interrupt under the same lock only after finding the queue empty
+    portENTER_CRITICAL(&tx_lock);
+    uart_ll_ena_intr_mask(hw, UART_INTR_TXFIFO_EMPTY);
+    portEXIT_CRITICAL(&tx_lock);
+    return true;
+}
+
+void crsf_uart_get_tx_stats(crsf_tx_stats_t *stats)
+{
+    stats->frames = __atomic_load_n(&tx_queue.frames, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&tx_queue.dropped, __ATOMIC_RELAXED);
+    stats->max_depth = __atomic_load_n(&tx_queue.max_depth, __ATOMIC_RELAXED);
+}
+
+TaskHandle_t crsf_uart_get_tx_task(void)
+{
+    return NULL; // the interrupt feeds the FIFO
+}
+
+size_t crsf_uart_memory_size(void)
+{
+    return sizeof(rx_ring) + sizeof(tx_queue) + intr_heap;
+}
+
+void crsf_uart_wait_tx_done(TickType_t timeout)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    while (crsf_txq_pending(&tx_queue) != 0 || !uart_ll_is_tx_idle(hw)) {
+        if (timeout != portMAX_DELAY && xTaskGetTickCount() - start >= timeout) {
+            return;
+        }
+        vTaskDelay(1);
+    }
+}
+
+void crsf_uart_flush_input(void)
+{
+    // the ring belongs to rx_task, it drops its content on the next receive
+    rx_flush = true;
+    if (rx_waiter != NULL) {
+        xTaskNotifyGive(rx_waiter);
+    }
+}
+
+esp_err_t crsf_uart_set_baudrate(uint32_t baud_rate)
+{
+    return uart_set_baudrate(uart_num, baud_rate);
+}
+
+esp_err_t crsf_uart_set_pins(uint8_t tx_pin, uint8_t rx_pin)
+{
+    return uart_set_pin(uart_num, tx_pin, rx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+}
@@ -0,0 +1,96 @@
+#include <math.h>
+#include <stdio.h>
+#include "crsf_encode.h"
+
+/*
+ * Checks crsf_encode_gps against hand-computed payloads: scaling and
+ * rounding to the wire units, heading wrap-around, saturation at the limits
+ * of the wire format and NaN inputs.
+ */
+
+typedef struct
+{
+    int32_t latitude;
+    int32_t longitude;
+    uint16_t ground_speed;
+    uint16_t heading;
+    uint16_t altitude;
+    uint8_t satellites;
+} wire_gps_t;
+
+static int failures;
+
+static int32_t get_be32(const uint8_t *in)
+{
+    return (int32_t)((uint32_t)in[0] << 24 | (uint32_t)in[1] << 16 | (uint32_t)in[2] << 8 | in[3]);
+}
+
+static uint16_t get_be16(const uint8_t *in)
+{
+    return in[0] << 8 | in[1];
+}
+
+static void check(const char *name, crsf_gps_fix_t fix, wire_gps_t expected)
+{
+    uint8_t payload[CRSF_GPS_PAYLOAD_SIZE];
+    size_t length = crsf_encode_gps(payload, &fix);
+
+    wire_gps_t got = {
+        .latitude = get_be32(&payload[0]),
+        .longitude = get_be32(&payload[4]),
+        .ground_speed = get_be16(&payload[8]),
+        .heading = get_be16(&payload[10]),
+        .altitude = get_be16(&payload[12]),
+        .satellites = payload[14],
+    };
+    if (length != CRSF_GPS_PAYLOAD_SIZE || got.latitude != expected.latitude ||
+        got.longitude != expected.longitude || got.ground_speed != expected.ground_speed ||
+        got.heading != expected.heading || got.altitude != expected.altitude ||
+        got.satellites != expected.satellites) {
+        printf("FAIL %s: got %zu bytes lat %d lon %d speed %u heading %u alt %u sats %u, "
+               "expected lat %d lon %d speed %u heading %u alt %u sats %u\n",
+               name, length, got.latitude, got.longitude, got.ground_speed, got.heading, got.altitude,
+               got.satellites, expected.latitude, expected.longitude, expected.ground_speed, expected.heading,
+               expected.altitude, expected.satellites);
+        failures++;
+    }
+}
+
+int main(void)
+{
+    int tests = 0;
+
+    // scaling: 1e-7 degree, 0.1 km/h, 0.01 degree, 1 m with a 1000 m offset, rounded to nearest
+    check("scaling", (crsf_gps_fix_t){ 52.2296756, 21.0122287, 10.0f, 123.456f, 100.4f, 12 },
+          (wire_gps_t){ 522296756, 210122287, 360, 12346, 1100, 12 });
+    check("southwest", (crsf_gps_fix_t){ -33.8688197, -151.2092955, 0.05f, 0.0f, -0.6f, 4 },
+          (wire_gps_t){ -338688197, -1512092955, 2, 0, 999, 4 });
+    tests += 2;
+
+    // heading: wrapped before scaling, so values just below 360 round to 0 and not to 36000
+    check("heading 359.999", (crsf_gps_fix_t){ .course_deg = 359.999f }, (wire_gps_t){ .altitude = 1000 });
+    check("heading 359.994", (crsf_gps_fix_t){ .course_deg = 359.994f }, (wire_gps_t){ .heading = 35999, .altitude = 1000 });
+    check("heading 360", (crsf_gps_fix_t){ .course_deg = 360.0f }, (wire_gps_t){ .altitude = 1000 });
+    check("heading 725", (crsf_gps_fix_t){ .course_deg = 725.0f }, (wire_gps_t){ .heading = 500, .altitude = 1000 });
+    check("heading -90", (crsf_gps_fix_t){ .course_deg = -90.0f }, (wire_gps_t){ .heading = 27000, .altitude = 1000 });
+    check("heading -0.001", (crsf_gps_fix_t){ .course_deg = -0.001f }, (wire_gps_t){ .altitude = 1000 });
+    check("heading -720", (crsf_gps_fix_t){ .course_deg = -720.0f }, (wire_gps_t){ .altitude = 1000 });
+    tests += 7;
+
+    // saturation at the limits of the wire format
+    check("saturate high", (crsf_gps_fix_t){ 91.0, 181.0, 2000.0f, 0.0f, 70000.0f, 255 },
+          (wire_gps_t){ 900000000, 1800000000, UINT16_MAX, 0, UINT16_MAX, 255 });
+    check("saturate low", (crsf_gps_fix_t){ -91.0, -181.0, -1.0f, 0.0f, -2000.0f, 0 },
+          (wire_gps_t){ -900000000, -1800000000, 0, 0, 0, 0 });
+    check("saturate infinity", (crsf_gps_fix_t){ INFINITY, -INFINITY, INFINITY, 0.0f, -INFINITY, 0 },
+          (wire_gps_t){ 900000000, -1800000000, UINT16_MAX, 0, 0, 0 });
+    tests += 3;
+
+    // NaN encodes as 0, or as the lowest altitude
+    check("nan", (crsf_gps_fix_t){ NAN, NAN, NAN, NAN, NAN, 7 }, (wire_gps_t){ .satellites = 7 });
+    check("infinite heading", (crsf_gps_fix_t){ .course_deg = INFINITY }, (wire_gps_t){ .altitude = 1000 });
+    tests += 2;
+
+    printf("%s %d GPS encoder cases, %d failed\n", failures ? "FAIL" : "PASS", tests, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "crsf_host_transport.h"
+
+// read a CRSF stream from a tty/pty and print receive statistics once per second
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s DEVICE [failsafe_timeout_ms]\n", argv[0]);
+        return 2;
+    }
+
+    crsf_host_transport_t transport;
+    if (crsf_host_open(&transport, argv[1]) < 0) {
+        perror("crsf_host_rx");
+        return 1;
+    }
+    if (argc > 2) {
+        transport.failsafe_timeout_us = strtoul(argv[2], NULL, 0) * 1000ULL;
+    }
+
+    uint64_t next_report = crsf_host_time_us() + 1000000;
+    uint32_t last_frames = 0;
+
+    for (;;) {
+        if (crsf_host_poll(&transport, 100) < 0) {
+            break;
+        }
+
+        uint64_t now = crsf_host_time_us();
+        if (now >= next_report) {
+            printf("frames/s %u crc_errors %u dropped_bytes %u failsafe %d (%u events) ch1 %u ch2 %u ch3 %u ch4 %u lq %u rate %u Hz (%u changes)\n",
+                   transport.parser.frames - last_frames, transport.parser.crc_errors,
+                   transport.parser.dropped_bytes, transport.failsafe, transport.failsafe_events,
+                   transport.channels[0], transport.channels[1], transport.channels[2], transport.channels[3],
+                   transport.link_statistics.up_link_quality, crsf_rate_hz(&transport.rate),
+                   transport.rate.rate_changes);
+            fflush(stdout);
+            last_frames = transport.parser.frames;
+            next_report += 1000000;
+        }
+    }
+
+    crsf_host_close(&transport);
+    return 0;
+}
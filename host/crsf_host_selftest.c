@@ -0,0 +1,138 @@
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "crsf_host_transport.h"
+
+/*
+ * Host counterpart of CRSF_selftest: frames are written to a pty master and
+ * read back from the slave through the host transport, at maximum rate.
+ * Reports frames/s, parser errors and the CPU time of the reading thread.
+ */
+
+typedef struct
+{
+    int fd;
+    volatile bool stop;
+    volatile bool finished;
+    uint32_t sent;
+} writer_t;
+
+typedef struct
+{
+    uint32_t received;
+    uint32_t lost;
+    uint32_t expected;
+} reader_t;
+
+static void *writer_thread(void *arg)
+{
+    writer_t *writer = arg;
+    uint8_t payload[CRSF_SELFTEST_PAYLOAD_SIZE];
+    uint8_t frame[CRSF_MAX_FRAME_SIZE];
+
+    memset(payload, 0xA5, sizeof(payload));
+    while (!writer->stop) {
+        uint32_t seq = writer->sent;
+        payload[0] = seq & 0xFF;
+        payload[1] = (seq >> 8) & 0xFF;
+        payload[2] = (seq >> 16) & 0xFF;
+        payload[3] = (seq >> 24) & 0xFF;
+        size_t len = crsf_build_frame(frame, CRSF_DEST_FC, CRSF_SELFTEST_TYPE, payload, sizeof(payload));
+
+        size_t done = 0;
+        // always finish the frame so the reader does not count a torn frame as lost
+        while (done < len) {
+            ssize_t n = write(writer->fd, frame + done, len - done);
+            if (n > 0) {
+                done += n;
+            }
+        }
+        writer->sent++;
+    }
+    writer->finished = true;
+    return NULL;
+}
+
+static void on_frame(const crsf_frame_t *frame, void *ctx)
+{
+    reader_t *reader = ctx;
+    if (frame->type != CRSF_SELFTEST_TYPE || frame->payload_length < 4) {
+        return;
+    }
+
+    const uint8_t *p = frame->payload;
+    uint32_t seq = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    if (seq > reader->expected) {
+        reader->lost += seq - reader->expected;
+    }
+    reader->expected = seq + 1;
+    reader->received++;
+}
+
+static uint64_t thread_cpu_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+int main(int argc, char **argv)
+{
+    double duration = argc > 1 ? strtod(argv[1], NULL) : 2.0;
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+        perror("crsf_host_selftest");
+        return 1;
+    }
+
+    crsf_host_transport_t transport;
+    if (crsf_host_open(&transport, ptsname(master)) < 0) {
+        perror("crsf_host_selftest");
+        return 1;
+    }
+
+    reader_t reader = {0};
+    transport.on_frame = on_frame;
+    transport.ctx = &reader;
+
+    writer_t writer = { .fd = master };
+    pthread_t thread;
+    pthread_create(&thread, NULL, writer_thread, &writer);
+
+    uint64_t start = crsf_host_time_us();
+    uint64_t cpu_start = thread_cpu_us();
+    uint64_t end = start + (uint64_t)(duration * 1e6);
+    while (crsf_host_time_us() < end) {
+        crsf_host_poll(&transport, 10);
+    }
+    // keep reading until the writer is done, it may be blocked on a full pty
+    writer.stop = true;
+    while (!writer.finished) {
+        crsf_host_poll(&transport, 1);
+    }
+    pthread_join(thread, NULL);
+
+    // drain what is still buffered in the pty
+    while (crsf_host_poll(&transport, 50) > 0) {
+    }
+
+    uint64_t elapsed = crsf_host_time_us() - start;
+    uint64_t cpu = thread_cpu_us() - cpu_start;
+    uint32_t lost = reader.lost + (writer.sent - reader.expected);
+    bool pass = writer.sent > 0 && lost == 0 && transport.parser.crc_errors == 0;
+
+    printf("%s sent %u received %u lost %u crc %u dropped %u bytes, %.0f frames/s, reader cpu %.0f%%\n",
+           pass ? "PASS" : "FAIL", writer.sent, reader.received, lost, transport.parser.crc_errors,
+           transport.parser.dropped_bytes, reader.received * 1e6 / elapsed, cpu * 100.0 / elapsed);
+
+    crsf_host_close(&transport);
+    close(master);
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "crsf_host_transport.h"
+
+#define DEFAULT_FAILSAFE_TIMEOUT_US 500000 // same as the driver
+
+uint64_t crsf_host_time_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void handle_frame(const crsf_frame_t *frame, void *ctx)
+{
+    crsf_host_transport_t *transport = ctx;
+
+    switch (frame->type) {
+        case CRSF_TYPE_CHANNELS:
+            if (frame->payload_length < CRSF_CHANNELS_PAYLOAD_SIZE) {
+                break;
+            }
+            crsf_unpack_channels(frame->payload, transport->channels);
+            transport->last_channels_us = transport->now_us;
+            crsf_rate_update(&transport->rate, transport->now_us);
+            transport->failsafe = false;
+            transport->channel_frames++;
+            break;
+
+        case CRSF_TYPE_LINK_STATISTICS:
+            if (frame->payload_length < sizeof(crsf_link_statistics_t)) {
+                break;
+            }
+            memcpy(&transport->link_statistics, frame->payload, sizeof(crsf_link_statistics_t));
+            transport->link_stats_frames++;
+            break;
+    }
+
+    if (transport->on_frame) {
+        transport->on_frame(frame, transport->ctx);
+    }
+}
+
+void crsf_host_init(crsf_host_transport_t *transport)
+{
+    static bool crc_ready = false;
+    if (!crc_ready) {
+        generate_CRC(0xd5);
+        crc_ready = true;
+    }
+
+    memset(transport, 0, sizeof(*transport));
+    transport->fd = -1;
+    transport->failsafe = true;
+    transport->failsafe_timeout_us = DEFAULT_FAILSAFE_TIMEOUT_US;
+    crsf_parser_init(&transport->parser);
+    crsf_rate_init(&transport->rate);
+}
+
+int crsf_host_open(crsf_host_transport_t *transport, const char *path)
+{
+    crsf_host_init(transport);
+
+    int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // a pty ignores the baud rate, real adapters have to be set up for 420000 baud beforehand
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    transport->fd = fd;
+    transport->last_channels_us = crsf_host_time_us();
+    return 0;
+}
+
+void crsf_host_close(crsf_host_transport_t *transport)
+{
+    if (transport->fd >= 0) {
+        close(transport->fd);
+        transport->fd = -1;
+    }
+}
+
+size_t crsf_host_feed(crsf_host_transport_t *transport, const uint8_t *data, size_t len, uint64_t now_us)
+{
+    transport->now_us = now_us;
+    crsf_host_update_failsafe(transport, now_us);
+    return crsf_parser_feed(&transport->parser, data, len, handle_frame, transport);
+}
+
+bool crsf_host_update_failsafe(crsf_host_transport_t *transport, uint64_t now_us)
+{
+    if (!transport->failsafe && now_us - transport->last_channels_us > transport->failsafe_timeout_us) {
+        transport->failsafe = true;
+        transport->failsafe_events++;
+    }
+    return transport->failsafe;
+}
+
+int crsf_host_poll(crsf_host_transport_t *transport, int timeout_ms)
+{
+    struct pollfd pfd = { .fd = transport->fd, .events = POLLIN };
+    int ready = poll(&pfd, 1, timeout_ms);
+
+    if (ready < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    if (ready == 0) {
+        crsf_host_update_failsafe(transport, crsf_host_time_us());
+        return 0;
+    }
+
+    uint8_t buf[256];
+    ssize_t len = read(transport->fd, buf, sizeof(buf));
+    if (len < 0) {
+        return errno == EAGAIN || errno == EINTR ? 0 : -1;
+    }
+    if (len == 0) {
+        return -1;
+    }
+
+    crsf_host_feed(transport, buf, len, crsf_host_time_us());
+    return len;
+}
+
+int crsf_host_send(crsf_host_transport_t *transport, uint8_t dest, uint8_t type, const void *payload, uint8_t payload_length)
+{
+    uint8_t frame[CRSF_MAX_FRAME_SIZE];
+    size_t len = crsf_build_frame(frame, dest, type, payload, payload_length);
+    if (len == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t n = write(transport->fd, frame + sent, len - sent);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        sent += n;
+    }
+    return 0;
+}
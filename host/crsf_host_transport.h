@@ -0,0 +1,122 @@
+#ifndef CRSF_HOST_TRANSPORT_H
+#define CRSF_HOST_TRANSPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "crsf_frame.h"
+#include "crsf_rate.h"
+
+/*
+ * Host (Linux) transport backend. Reads a CRSF stream from a tty or pty,
+ * runs it through the same parser as the ESP-IDF driver and keeps the same
+ * channel, link statistics and failsafe state, so the simulator can be used
+ * to benchmark parsing and failsafe behaviour off target.
+ */
+
+/**
+ * @brief host transport state
+ *
+ * @param fd file descriptor of the tty/pty, -1 when fed from memory
+ * @param parser frame parser, holds frame and error counters
+ * @param channels latest channel values
+ * @param link_statistics latest link statistics
+ * @param failsafe_timeout_us failsafe is entered when no RC frame arrives for this long
+ * @param failsafe true while in failsafe
+ * @param failsafe_events number of transitions into failsafe
+ * @param last_channels_us time of the last RC frame
+ * @param now_us receive time of the bytes currently being parsed
+ * @param rate RC frame rate estimate
+ * @param channel_frames number of RC frames received
+ * @param link_stats_frames number of link statistics frames received
+ * @param on_frame optional hook called for every valid frame
+ * @param ctx passed to on_frame
+ */
+typedef struct
+{
+    int fd;
+    crsf_parser_t parser;
+    uint16_t channels[16];
+    crsf_link_statistics_t link_statistics;
+    uint64_t failsafe_timeout_us;
+    bool failsafe;
+    uint32_t failsafe_events;
+    uint64_t last_channels_us;
+    uint64_t now_us;
+    crsf_rate_estimator_t rate;
+    uint64_t channel_frames;
+    uint64_t link_stats_frames;
+    crsf_frame_handler_t on_frame;
+    void *ctx;
+} crsf_host_transport_t;
+
+/**
+ * @brief monotonic time in microseconds
+ */
+uint64_t crsf_host_time_us(void);
+
+/**
+ * @brief initialize the transport without a device, data is supplied with crsf_host_feed
+ *
+ * @param transport pointer to the transport
+ */
+void crsf_host_init(crsf_host_transport_t *transport);
+
+/**
+ * @brief open a tty or pty in raw mode
+ *
+ * @param transport pointer to the transport
+ * @param path device path, e.g. the slave printed by crsf_sim
+ * @return int 0 on success, -1 on error (errno set)
+ */
+int crsf_host_open(crsf_host_transport_t *transport, const char *path);
+
+/**
+ * @brief close the device
+ *
+ * @param transport pointer to the transport
+ */
+void crsf_host_close(crsf_host_transport_t *transport);
+
+/**
+ * @brief wait for data, parse it and update the failsafe state
+ *
+ * @param transport pointer to the transport
+ * @param timeout_ms maximum time to wait for data, -1 waits forever
+ * @return int number of bytes read, 0 on timeout, -1 on error or end of stream
+ */
+int crsf_host_poll(crsf_host_transport_t *transport, int timeout_ms);
+
+/**
+ * @brief parse bytes received at a given time (in-memory and benchmark use)
+ *
+ * @param transport pointer to the transport
+ * @param data received bytes
+ * @param len number of bytes
+ * @param now_us receive time of the bytes
+ * @return size_t number of valid frames
+ */
+size_t crsf_host_feed(crsf_host_transport_t *transport, const uint8_t *data, size_t len, uint64_t now_us);
+
+/**
+ * @brief update the failsafe state for the given time
+ *
+ * @param transport pointer to the transport
+ * @param now_us current time
+ * @return bool true while in failsafe
+ */
+bool crsf_host_update_failsafe(crsf_host_transport_t *transport, uint64_t now_us);
+
+/**
+ * @brief send a frame to the device
+ *
+ * @param transport pointer to the transport
+ * @param dest destination address
+ * @param type frame type
+ * @param payload payload bytes
+ * @param payload_length payload length
+ * @return int 0 on success, -1 on error
+ */
+int crsf_host_send(crsf_host_transport_t *transport, uint8_t dest, uint8_t type, const void *payload, uint8_t payload_length);
+
+#endif /* CRSF_HOST_TRANSPORT_H */
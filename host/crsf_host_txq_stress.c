@@ -0,0 +1,150 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "crsf_frame.h"
+#include "crsf_txq.h"
+
+/*
+ * Stress test of the transmit queue: several producer threads queue frames
+ * concurrently while one consumer thread takes them, as the UART interrupt
+ * does. Every frame must arrive exactly once, whole, with a valid CRC and in
+ * the order its producer queued it; the statistics must match what the
+ * producers saw. A full queue makes a producer retry, so drops are counted
+ * but nothing is lost.
+ */
+
+#define PRODUCERS 4
+#define HEADER_SIZE 5 // producer id + uint32 sequence number
+
+typedef struct
+{
+    crsf_txq_t *queue;
+    uint8_t id;
+    uint32_t frames;
+    uint32_t full; // pushes refused because the queue was full
+} producer_t;
+
+typedef struct
+{
+    crsf_txq_t *queue;
+    uint32_t total;
+    uint32_t received;
+    uint32_t expected[PRODUCERS];
+    uint32_t errors;
+} consumer_t;
+
+static uint8_t payload_length(uint32_t seq)
+{
+    return HEADER_SIZE + seq % (CRSF_MAX_PAYLOAD_SIZE - HEADER_SIZE + 1);
+}
+
+static uint8_t fill_byte(uint8_t id, uint32_t seq, size_t i)
+{
+    return (uint8_t)(seq * 7 + id * 31 + i);
+}
+
+static void *producer_thread(void *arg)
+{
+    producer_t *producer = arg;
+    uint8_t payload[CRSF_MAX_PAYLOAD_SIZE];
+    uint8_t frame[CRSF_MAX_FRAME_SIZE];
+
+    for (uint32_t seq = 0; seq < producer->frames; seq++) {
+        uint8_t length = payload_length(seq);
+        payload[0] = producer->id;
+        memcpy(&payload[1], &seq, sizeof(seq));
+        for (size_t i = HEADER_SIZE; i < length; i++) {
+            payload[i] = fill_byte(producer->id, seq, i);
+        }
+        size_t frame_length = crsf_build_frame(frame, CRSF_DEST_FC, CRSF_SELFTEST_TYPE, payload, length);
+
+        while (!crsf_txq_push(producer->queue, frame, frame_length)) {
+            producer->full++;
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void check_frame(consumer_t *consumer, const uint8_t *frame, size_t length)
+{
+    uint8_t payload_len = frame[1] - 2;
+
+    if (length < 4 + HEADER_SIZE || length != (size_t)frame[1] + 2 || frame[2] != CRSF_SELFTEST_TYPE ||
+        crc8(&frame[2], frame[1] - 1) != frame[length - 1]) {
+        consumer->errors++;
+        return;
+    }
+
+    const uint8_t *payload = &frame[3];
+    uint8_t id = payload[0];
+    uint32_t seq;
+    memcpy(&seq, &payload[1], sizeof(seq));
+    if (id >= PRODUCERS || seq != consumer->expected[id] || payload_len != payload_length(seq)) {
+        consumer->errors++;
+        return;
+    }
+    for (size_t i = HEADER_SIZE; i < payload_len; i++) {
+        if (payload[i] != fill_byte(id, seq, i)) {
+            consumer->errors++;
+            return;
+        }
+    }
+    consumer->expected[id]++;
+}
+
+static void *consumer_thread(void *arg)
+{
+    consumer_t *consumer = arg;
+
+    while (consumer->received < consumer->total) {
+        const uint8_t *frame;
+        size_t length = crsf_txq_peek(consumer->queue, &frame);
+        if (length == 0) {
+            sched_yield();
+            continue;
+        }
+        check_frame(consumer, frame, length);
+        crsf_txq_pop(consumer->queue);
+        consumer->received++;
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t frames = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000000;
+    static crsf_txq_t queue;
+    producer_t producers[PRODUCERS];
+    pthread_t threads[PRODUCERS + 1];
+
+    generate_CRC(0xd5);
+    crsf_txq_init(&queue);
+
+    consumer_t consumer = { .queue = &queue, .total = frames * PRODUCERS };
+    pthread_create(&threads[PRODUCERS], NULL, consumer_thread, &consumer);
+    for (int i = 0; i < PRODUCERS; i++) {
+        producers[i] = (producer_t){ .queue = &queue, .id = i, .frames = frames };
+        pthread_create(&threads[i], NULL, producer_thread, &producers[i]);
+    }
+    for (int i = 0; i <= PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    uint32_t full = 0;
+    bool in_order = true;
+    for (int i = 0; i < PRODUCERS; i++) {
+        full += producers[i].full;
+        in_order &= consumer.expected[i] == frames;
+    }
+    bool pass = consumer.errors == 0 && in_order && queue.frames == consumer.total && queue.dropped == full &&
+                crsf_txq_pending(&queue) == 0 && queue.max_depth <= CRSF_TXQ_SLOTS;
+
+    printf("%s %d producers, %u frames, %u errors, %u refused while full, max depth %u of %d\n",
+           pass ? "PASS" : "FAIL", PRODUCERS, consumer.received, consumer.errors, queue.dropped, queue.max_depth,
+           CRSF_TXQ_SLOTS);
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+#include <math.h>
+#include <string.h>
+#include "crsf_sim.h"
+#include "crsf_frame.h"
+
+#define CHANNEL_RANGE (CRSF_CHANNEL_VALUE_MAX - CRSF_CHANNEL_VALUE_MIN)
+
+// xorshift64*, good enough for noise and reproducible across platforms
+static uint64_t next_random(crsf_sim_t *sim)
+{
+    sim->rng ^= sim->rng >> 12;
+    sim->rng ^= sim->rng << 25;
+    sim->rng ^= sim->rng >> 27;
+    return sim->rng * 0x2545F4914F6CDD1DULL;
+}
+
+static double next_uniform(crsf_sim_t *sim)
+{
+    return (next_random(sim) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// distance to the next flipped bit, geometric so the cost does not depend on the stream length
+static uint64_t next_error_distance(crsf_sim_t *sim)
+{
+    double p = sim->config.bit_error_rate;
+    if (p <= 0.0) {
+        return UINT64_MAX;
+    }
+    if (p >= 1.0) {
+        return 0;
+    }
+    double u = next_uniform(sim);
+    if (u <= 0.0) {
+        u = 1e-300;
+    }
+    return (uint64_t)floor(log(u) / log1p(-p));
+}
+
+static uint16_t trajectory_value(crsf_sim_t *sim, int ch, double t)
+{
+    double phase = t * sim->config.trajectory_hz + ch / 16.0;
+    double frac = phase - floor(phase);
+
+    switch (sim->config.trajectory[ch]) {
+        case CRSF_SIM_SINE:
+            return CRSF_CHANNEL_VALUE_MID + lround(sin(2.0 * M_PI * frac) * CHANNEL_RANGE / 2.0);
+        case CRSF_SIM_SQUARE:
+            // same phase on every channel so a toggle is visible on all of them at once
+            phase = t * sim->config.trajectory_hz;
+            return phase - floor(phase) < 0.5 ? CRSF_CHANNEL_VALUE_MIN : CRSF_CHANNEL_VALUE_MAX;
+        case CRSF_SIM_RAMP:
+            return CRSF_CHANNEL_VALUE_MIN + lround(frac * CHANNEL_RANGE);
+        case CRSF_SIM_NOISE: {
+            int value = sim->channels[ch] + (int)(next_random(sim) % 17) - 8;
+            if (value < CRSF_CHANNEL_VALUE_MIN) {
+                value = CRSF_CHANNEL_VALUE_MIN;
+            } else if (value > CRSF_CHANNEL_VALUE_MAX) {
+                value = CRSF_CHANNEL_VALUE_MAX;
+            }
+            return value;
+        }
+        case CRSF_SIM_HOLD:
+        default:
+            return CRSF_CHANNEL_VALUE_MID;
+    }
+}
+
+static size_t build_link_statistics(crsf_sim_t *sim, uint8_t *buf)
+{
+    double lq = 100.0 * (1.0 - sim->config.drop_rate);
+    crsf_link_statistics_t stats = {
+        .up_rssi_ant1 = 40 + next_random(sim) % 8,
+        .up_rssi_ant2 = 42 + next_random(sim) % 8,
+        .up_link_quality = lq < 0.0 ? 0 : (uint8_t)lq,
+        .up_snr = 8,
+        .active_antenna = 0,
+        .rf_profile = 2,
+        .up_rf_power = 3,
+        .down_rssi = 45 + next_random(sim) % 8,
+        .down_link_quality = lq < 0.0 ? 0 : (uint8_t)lq,
+        .down_snr = 6
+    };
+
+    return crsf_build_frame(buf, CRSF_DEST_FC, CRSF_TYPE_LINK_STATISTICS, &stats, sizeof(stats));
+}
+
+static void inject_bit_errors(crsf_sim_t *sim, uint8_t *buf, size_t len)
+{
+    uint64_t bits = (uint64_t)len * 8;
+    uint64_t pos = 0;
+
+    while (sim->bits_to_next_error < bits - pos) {
+        pos += sim->bits_to_next_error;
+        buf[pos / 8] ^= 1 << (pos % 8);
+        sim->stats.flipped_bits++;
+        pos++;
+        sim->bits_to_next_error = next_error_distance(sim);
+    }
+    sim->bits_to_next_error -= bits - pos;
+}
+
+void crsf_sim_default_config(crsf_sim_config_t *config)
+{
+    memset(config, 0, sizeof(*config));
+    config->packet_rate_hz = 150;
+    config->link_stats_every = 50;
+    config->telemetry_ratio = 64;
+    config->trajectory_hz = 1.0;
+    config->seed = 1;
+    for (int ch = 0; ch < 16; ch++) {
+        config->trajectory[ch] = CRSF_SIM_SINE;
+    }
+}
+
+void crsf_sim_init(crsf_sim_t *sim, const crsf_sim_config_t *config)
+{
+    static bool crc_ready = false;
+    if (!crc_ready) {
+        generate_CRC(0xd5);
+        crc_ready = true;
+    }
+
+    memset(sim, 0, sizeof(*sim));
+    sim->config = *config;
+    if (sim->config.packet_rate_hz == 0) {
+        sim->config.packet_rate_hz = 150;
+    }
+    sim->rng = ((uint64_t)config->seed << 32) ^ 0x9E3779B97F4A7C15ULL;
+    sim->bits_to_next_error = next_error_distance(sim);
+    for (int ch = 0; ch < 16; ch++) {
+        sim->channels[ch] = CRSF_CHANNEL_VALUE_MID;
+    }
+}
+
+uint64_t crsf_sim_slot_time_us(const crsf_sim_t *sim)
+{
+    return sim->stats.slots * 1000000ULL / sim->config.packet_rate_hz;
+}
+
+size_t crsf_sim_next(crsf_sim_t *sim, uint8_t *buf)
+{
+    const crsf_sim_config_t *config = &sim->config;
+    double t = (double)sim->stats.slots / config->packet_rate_hz;
+    uint64_t slot = sim->stats.slots++;
+    size_t len = 0;
+
+    // the channels keep moving even if this slot never reaches the receiver
+    for (int ch = 0; ch < 16; ch++) {
+        sim->channels[ch] = trajectory_value(sim, ch, t);
+    }
+
+    if (config->telemetry_ratio > 0 && slot % config->telemetry_ratio == config->telemetry_ratio - 1) {
+        // downlink slot, the receiver outputs nothing and the FC may send telemetry
+        sim->stats.telemetry_slots++;
+        return 0;
+    }
+
+    if (config->drop_rate > 0.0 && next_uniform(sim) < config->drop_rate) {
+        sim->stats.dropped_slots++;
+        return 0;
+    }
+
+    uint8_t payload[CRSF_CHANNELS_PAYLOAD_SIZE];
+    crsf_pack_channels(sim->channels, payload);
+    len += crsf_build_frame(buf, CRSF_DEST_FC, CRSF_TYPE_CHANNELS, payload, sizeof(payload));
+    sim->stats.rc_frames++;
+
+    if (config->link_stats_every > 0 && sim->stats.rc_frames % config->link_stats_every == 0) {
+        len += build_link_statistics(sim, buf + len);
+        sim->stats.link_stats_frames++;
+    }
+
+    inject_bit_errors(sim, buf, len);
+    sim->stats.bytes += len;
+
+    return len;
+}
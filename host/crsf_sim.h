@@ -0,0 +1,119 @@
+#ifndef CRSF_SIM_H
+#define CRSF_SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "crsf_protocol.h"
+
+/*
+ * CRSF receiver simulator. Generates the byte stream an ELRS/Crossfire receiver
+ * would put on its UART, one packet slot at a time, so the parser and the
+ * failsafe logic can be exercised without radios. Output is deterministic for a
+ * given seed.
+ */
+
+#define CRSF_SIM_MAX_SLOT_SIZE (2 * CRSF_MAX_FRAME_SIZE) // RC frame + link statistics
+
+/**
+ * @brief channel trajectory generated by the simulator
+ */
+typedef enum
+{
+    CRSF_SIM_HOLD = 0, // constant at CRSF_CHANNEL_VALUE_MID
+    CRSF_SIM_SINE,     // full range sine
+    CRSF_SIM_SQUARE,   // toggles between min and max, known pattern for latency tests
+    CRSF_SIM_RAMP,     // sawtooth from min to max
+    CRSF_SIM_NOISE     // bounded random walk
+} crsf_sim_trajectory_t;
+
+/**
+ * @brief simulator configuration
+ *
+ * @param packet_rate_hz RC packet rate of the simulated link (50 Hz to 1 kHz and above)
+ * @param link_stats_every emit a link statistics frame every N RC frames, 0 disables
+ * @param telemetry_ratio 1:N telemetry ratio, every Nth slot is a downlink slot without RC frame, 0 disables
+ * @param bit_error_rate probability of each transmitted bit being flipped
+ * @param drop_rate probability of a slot being lost completely
+ * @param trajectory_hz frequency of the sine, square and ramp trajectories
+ * @param trajectory trajectory of each of the 16 channels
+ * @param seed random seed, same seed gives the same stream
+ */
+typedef struct
+{
+    uint32_t packet_rate_hz;
+    uint32_t link_stats_every;
+    uint32_t telemetry_ratio;
+    double bit_error_rate;
+    double drop_rate;
+    double trajectory_hz;
+    crsf_sim_trajectory_t trajectory[16];
+    uint32_t seed;
+} crsf_sim_config_t;
+
+/**
+ * @brief counters of what the simulator generated
+ */
+typedef struct
+{
+    uint64_t slots;
+    uint64_t rc_frames;
+    uint64_t link_stats_frames;
+    uint64_t telemetry_slots;
+    uint64_t dropped_slots;
+    uint64_t flipped_bits;
+    uint64_t bytes;
+} crsf_sim_stats_t;
+
+typedef struct
+{
+    crsf_sim_config_t config;
+    crsf_sim_stats_t stats;
+    uint64_t rng;
+    uint64_t bits_to_next_error;
+    uint16_t channels[16];
+} crsf_sim_t;
+
+/**
+ * @brief fill config with a 150 Hz, error free link with 1:64 telemetry
+ *
+ * @param config pointer to the config
+ */
+void crsf_sim_default_config(crsf_sim_config_t *config);
+
+/**
+ * @brief initialize the simulator
+ *
+ * @param sim pointer to the simulator state
+ * @param config pointer to the configuration, copied
+ */
+void crsf_sim_init(crsf_sim_t *sim, const crsf_sim_config_t *config);
+
+/**
+ * @brief time of the next slot relative to the start of the stream
+ *
+ * @param sim pointer to the simulator state
+ * @return uint64_t time in microseconds
+ */
+uint64_t crsf_sim_slot_time_us(const crsf_sim_t *sim);
+
+/**
+ * @brief generate the bytes of the next packet slot
+ *
+ * @param sim pointer to the simulator state
+ * @param buf output buffer of at least CRSF_SIM_MAX_SLOT_SIZE bytes
+ * @return size_t number of bytes, 0 for dropped and telemetry slots
+ */
+size_t crsf_sim_next(crsf_sim_t *sim, uint8_t *buf);
+
+/**
+ * @brief channel values sent in the last RC frame
+ *
+ * @param sim pointer to the simulator state
+ * @return const uint16_t* array of 16 channel values
+ */
+static inline const uint16_t *crsf_sim_channels(const crsf_sim_t *sim)
+{
+    return sim->channels;
+}
+
+#endif /* CRSF_SIM_H */
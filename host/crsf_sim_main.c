@@ -0,0 +1,239 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "crsf_sim.h"
+#include "crsf_host_transport.h"
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -r HZ     packet rate (default 150)\n"
+            "  -d SEC    duration, 0 runs forever (default 0)\n"
+            "  -e BER    bit error rate (default 0)\n"
+            "  -x P      probability of dropping a slot (default 0)\n"
+            "  -t N      1:N telemetry ratio, 0 disables (default 64)\n"
+            "  -l N      link statistics every N RC frames, 0 disables (default 50)\n"
+            "  -m TRAJ   hold|sine|square|ramp|noise for all channels (default sine)\n"
+            "  -f HZ     trajectory frequency (default 1)\n"
+            "  -s SEED   random seed (default 1)\n"
+            "  -o PATH   write to PATH instead of a new pty, '-' for stdout\n"
+            "  -b SLOTS  benchmark: parse SLOTS slots in memory and report throughput\n",
+            prog);
+}
+
+static int parse_trajectory(const char *name, crsf_sim_trajectory_t *traj)
+{
+    static const char *names[] = { "hold", "sine", "square", "ramp", "noise" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(name, names[i]) == 0) {
+            *traj = (crsf_sim_trajectory_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int open_pty(int *slave_fd)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+        return -1;
+    }
+
+    // keep the slave open in raw mode so nothing is echoed or translated before a reader attaches
+    const char *name = ptsname(master);
+    int slave = open(name, O_RDWR | O_NOCTTY);
+    if (slave < 0) {
+        return -1;
+    }
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    printf("%s\n", name);
+    fflush(stdout);
+    *slave_fd = slave;
+    return master;
+}
+
+static int write_all(int fd, const uint8_t *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static void print_sim_stats(const crsf_sim_stats_t *stats)
+{
+    fprintf(stderr,
+            "slots %llu rc %llu link_stats %llu telemetry %llu dropped %llu flipped_bits %llu bytes %llu\n",
+            (unsigned long long)stats->slots, (unsigned long long)stats->rc_frames,
+            (unsigned long long)stats->link_stats_frames, (unsigned long long)stats->telemetry_slots,
+            (unsigned long long)stats->dropped_slots, (unsigned long long)stats->flipped_bits,
+            (unsigned long long)stats->bytes);
+}
+
+// generate the stream in memory and time the parser on it, slot timestamps drive the failsafe logic
+static int run_benchmark(crsf_sim_t *sim, uint64_t slots)
+{
+    size_t len = 0;
+    uint8_t *stream = malloc(slots * CRSF_SIM_MAX_SLOT_SIZE);
+    uint64_t *times = malloc(slots * sizeof(uint64_t));
+    size_t *lengths = malloc(slots * sizeof(size_t));
+    if (!stream || !times || !lengths) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    for (uint64_t i = 0; i < slots; i++) {
+        times[i] = crsf_sim_slot_time_us(sim);
+        lengths[i] = crsf_sim_next(sim, stream + len);
+        len += lengths[i];
+    }
+
+    crsf_host_transport_t transport;
+    crsf_host_init(&transport);
+
+    uint64_t start = crsf_host_time_us();
+    size_t offset = 0;
+    for (uint64_t i = 0; i < slots; i++) {
+        crsf_host_feed(&transport, stream + offset, lengths[i], times[i]);
+        offset += lengths[i];
+    }
+    uint64_t elapsed = crsf_host_time_us() - start;
+    if (elapsed == 0) {
+        elapsed = 1;
+    }
+
+    print_sim_stats(&sim->stats);
+    printf("parsed %zu bytes in %llu us: %.1f MB/s, %.0f frames/s\n", len, (unsigned long long)elapsed,
+           (double)len / elapsed, transport.parser.frames * 1e6 / elapsed);
+    printf("frames %u crc_errors %u dropped_bytes %u rc %llu link_stats %llu failsafe_events %u rate %u Hz\n",
+           transport.parser.frames, transport.parser.crc_errors, transport.parser.dropped_bytes,
+           (unsigned long long)transport.channel_frames, (unsigned long long)transport.link_stats_frames,
+           transport.failsafe_events, crsf_rate_hz(&transport.rate));
+
+    free(lengths);
+    free(times);
+    free(stream);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    crsf_sim_config_t config;
+    crsf_sim_default_config(&config);
+    double duration = 0;
+    const char *output = NULL;
+    uint64_t bench_slots = 0;
+    crsf_sim_trajectory_t traj = CRSF_SIM_SINE;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:d:e:x:t:l:m:f:s:o:b:h")) != -1) {
+        switch (opt) {
+            case 'r': config.packet_rate_hz = strtoul(optarg, NULL, 0); break;
+            case 'd': duration = strtod(optarg, NULL); break;
+            case 'e': config.bit_error_rate = strtod(optarg, NULL); break;
+            case 'x': config.drop_rate = strtod(optarg, NULL); break;
+            case 't': config.telemetry_ratio = strtoul(optarg, NULL, 0); break;
+            case 'l': config.link_stats_every = strtoul(optarg, NULL, 0); break;
+            case 'f': config.trajectory_hz = strtod(optarg, NULL); break;
+            case 's': config.seed = strtoul(optarg, NULL, 0); break;
+            case 'o': output = optarg; break;
+            case 'b': bench_slots = strtoull(optarg, NULL, 0); break;
+            case 'm':
+                if (parse_trajectory(optarg, &traj) < 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    for (int ch = 0; ch < 16; ch++) {
+        config.trajectory[ch] = traj;
+    }
+    if (config.packet_rate_hz == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    crsf_sim_t sim;
+    crsf_sim_init(&sim, &config);
+
+    if (bench_slots > 0) {
+        return run_benchmark(&sim, bench_slots);
+    }
+
+    int slave = -1;
+    int fd;
+    if (output == NULL) {
+        fd = open_pty(&slave);
+    } else if (strcmp(output, "-") == 0) {
+        fd = STDOUT_FILENO;
+    } else {
+        fd = open(output, O_WRONLY | O_NOCTTY);
+    }
+    if (fd < 0) {
+        perror("crsf_sim");
+        return 1;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t end_us = duration > 0 ? (uint64_t)(duration * 1e6) : UINT64_MAX;
+    uint8_t buf[CRSF_SIM_MAX_SLOT_SIZE];
+
+    for (;;) {
+        uint64_t t = crsf_sim_slot_time_us(&sim);
+        if (t >= end_us) {
+            break;
+        }
+
+        // absolute deadlines so the rate does not drift with write latency
+        struct timespec deadline = start;
+        deadline.tv_sec += t / 1000000;
+        deadline.tv_nsec += (t % 1000000) * 1000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+        }
+
+        size_t len = crsf_sim_next(&sim, buf);
+        if (len > 0 && write_all(fd, buf, len) < 0) {
+            perror("crsf_sim: write");
+            break;
+        }
+    }
+
+    print_sim_stats(&sim.stats);
+    if (slave >= 0) {
+        close(slave);
+    }
+    if (fd != STDOUT_FILENO) {
+        close(fd);
+    }
+    return 0;
+}
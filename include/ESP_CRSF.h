@@ -1,3 +1,6 @@
+#ifndef ESP_CRSF_H
+#define ESP_CRSF_H
+
 #include "stdio.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -9,6 +12,23 @@
 #include <string.h>
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "crsf_protocol.h"
+#include "crsf_filter.h"
+#include "crsf_encode.h"
+
+/**
+ * @brief protocol of the receiver connected to rx_pin
+ *
+ * All inputs feed the same channel snapshot, failsafe and events. Telemetry,
+ * link statistics, commands and the MAVLink tunnel need CRSF.
+ */
+typedef enum
+{
+    CRSF_INPUT_CRSF, // CRSF over the UART
+    CRSF_INPUT_SBUS, // SBUS over the UART, 100000 baud 8E2 inverted (CONFIG_CRSF_INPUT_SBUS)
+    CRSF_INPUT_PPM   // PPM on rx_pin, timed with a GPIO interrupt, the UART is not used (CONFIG_CRSF_INPUT_PPM)
+} crsf_input_t;
 
 /**
  * @brief struct to hold the configuration of the CRSF
@@ -16,6 +36,8 @@
  * @param uart_num the uart controller number to use
  * @param tx_pin the tx pin of the esp uart
  * @param rx_pin the rx pin of the esp uart
+ * @param baud_rate baud rate of the link, 0 for CONFIG_CRSF_BAUD_RATE (CRSF_SBUS_BAUD_RATE for SBUS)
+ * @param input receiver protocol, CRSF_INPUT_CRSF when zero-initialized
  *
  */
 typedef struct
@@ -23,177 +45,534 @@ typedef struct
     uint8_t uart_num;
     uint8_t tx_pin;
     uint8_t rx_pin;
+    uint32_t baud_rate;
+    crsf_input_t input;
 } crsf_config_t;
 
 /**
- * @brief structure for handling 16 channels of data, 11 bits each. Which channel is used depends on transmitter setting
+ * @brief events a task can subscribe to, delivered as task notification bits
+ */
+typedef enum
+{
+    CRSF_EVENT_CHANNELS = (1 << 0),        // new channel frame published
+    CRSF_EVENT_LINK_STATISTICS = (1 << 1), // new link statistics published
+    CRSF_EVENT_FAILSAFE = (1 << 2),        // failsafe entered or left, check CRSF_is_failsafe
+    CRSF_EVENT_RATE_CHANGED = (1 << 3),    // frame rate estimate locked or the packet rate changed
+    CRSF_EVENT_PHASE_WAKE = (1 << 4)       // internal, phase-locked wake-up of CRSF_phase_lock_wait
+} crsf_event_t;
+
+#define CRSF_MAX_SUBSCRIBERS 4
+
+/**
+ * @brief stages of the receive path measured by the latency mode
+ */
+typedef enum
+{
+    CRSF_LATENCY_WIRE = 0,  // first start bit to last stop bit of the frame, from frame size and baud rate
+    CRSF_LATENCY_UART,      // end of frame to rx_task wake-up (RX timeout, UART ISR and event queue)
+    CRSF_LATENCY_RX_TASK,   // rx_task wake-up to frame parsed
+    CRSF_LATENCY_PUBLISH,   // frame parsed to channels published and subscribers notified
+    CRSF_LATENCY_CONSUMER,  // published to first consumer observing the new value
+    CRSF_LATENCY_TOTAL,     // first start bit to first consumer observing the new value
+    CRSF_LATENCY_STAGES
+} crsf_latency_stage_t;
+
+#define CRSF_LATENCY_BUCKETS 16 // bucket i counts samples in [2^i, 2^(i+1)) us, bucket 0 also counts 0 us
+
+/**
+ * @brief latency histogram of one stage
  *
- * @return typedef struct
+ * @param count number of samples
+ * @param min_us smallest sample
+ * @param max_us largest sample
+ * @param sum_us sum of all samples, for the average
+ * @param buckets log2 histogram in microseconds
  */
-typedef struct __attribute__((packed))
+typedef struct
 {
-    unsigned ch1 : 11;
-    unsigned ch2 : 11;
-    unsigned ch3 : 11;
-    unsigned ch4 : 11;
-    unsigned ch5 : 11;
-    unsigned ch6 : 11;
-    unsigned ch7 : 11;
-    unsigned ch8 : 11;
-    unsigned ch9 : 11;
-    unsigned ch10 : 11;
-    unsigned ch11 : 11;
-    unsigned ch12 : 11;
-    unsigned ch13 : 11;
-    unsigned ch14 : 11;
-    unsigned ch15 : 11;
-    unsigned ch16 : 11;
-} crsf_channels_t;
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t buckets[CRSF_LATENCY_BUCKETS];
+} crsf_latency_histogram_t;
 
 /**
- * @brief struct for battery data telemetry
+ * @brief latency report
  *
- * @param voltage the voltage of the battery in 10*V (1 = 0.1V)
- * @param current the current of the battery in 10*A (1 = 0.1A)
- * @param capacity the capacity of the battery in mah
- * @param remaining the remaining percentage of the battery
+ * @param stage histogram per stage
+ * @param rejected channel frames not measured (no start edge, frame shared a UART event, no change on toggle channel)
+ */
+typedef struct
+{
+    crsf_latency_histogram_t stage[CRSF_LATENCY_STAGES];
+    uint32_t rejected;
+} crsf_latency_report_t;
+
+/**
+ * @brief latency measurement configuration
  *
+ * @param toggle_channel channel index (0-15) toggled by the test source, only frames changing it are measured, -1 measures every frame
  */
-typedef struct __attribute__((packed))
+typedef struct
 {
-    unsigned voltage : 16;  // V * 10 big endian
-    unsigned current : 16;  // A * 10 big endian
-    unsigned capacity : 24; // mah big endian
-    unsigned remaining : 8; // %
-} crsf_battery_t;
+    int8_t toggle_channel;
+} crsf_latency_config_t;
 
 /**
- * @brief struct for GPS data telemetry
+ * @brief estimated RC frame rate
  *
- * @param latitude int32 the latitude of the GPS in degree / 10,000,000 big endian
- * @param longitude int32 the longitude of the GPS in degree / 10,000,000 big endian
- * @param groundspeed uint16 the groundspeed of the GPS in km/h / 10 big endian
- * @param heading uint16 the heading of the GPS in degree/100 big endian
- * @param altitude uint16 the altitude of the GPS in meters, +1000m big endian
- * @param satellites uint8 the number of satellites
+ * @param interval_us estimated interval between RC frames
+ * @param rate_hz estimated frame rate
+ * @param jitter_us average deviation of the arrival times from the estimate
+ * @param rate_changes number of packet rate changes detected since CRSF_init
+ * @param last_arrival_us esp_timer time of the last RC frame
+ */
+typedef struct
+{
+    uint32_t interval_us;
+    uint32_t rate_hz;
+    uint32_t jitter_us;
+    uint32_t rate_changes;
+    int64_t last_arrival_us;
+} crsf_frame_rate_t;
+
+/**
+ * @brief one channels frame from the history
  *
+ * @param arrival_us esp_timer time the frame was decoded
+ * @param seq sequence number of the frame, counts every channels frame since CRSF_init
+ * @param channels channel values
  */
-typedef struct __attribute__((packed))
+typedef struct
 {
-    int32_t latitude;     // degree / 10,000,000 big endian
-    int32_t longitude;    // degree / 10,000,000 big endian
-    uint16_t groundspeed; // km/h / 10 big endian
-    uint16_t heading;     // GPS heading, degree/100 big endian
-    uint16_t altitude;    // meters, +1000m big endian
-    uint8_t satellites;   // satellites
-} crsf_gps_t;
+    int64_t arrival_us;
+    uint32_t seq;
+    crsf_channels_t channels;
+} crsf_channel_sample_t;
 
-typedef struct __attribute__((packed))
+/**
+ * @brief RAM used by the receive path, in bytes
+ *
+ * Every allocation of the receive and transmit path is counted, including
+ * the UART driver's own state and event queue (measured on the heap when the
+ * driver is installed) and the FreeRTOS objects; only the few bytes of heap
+ * bookkeeping per block are not. Optional features (MAVLink buffers, command
+ * slots, outputs, ...) are not included, CONFIG_CRSF_SIZE_REPORT lists their
+ * static RAM at build time.
+ *
+ * @param rx_task_stack_size configured rx_task stack
+ * @param rx_task_stack_free_min smallest stack reserve rx_task had so far (high-water mark), 0 before CRSF_init
+ * @param tx_task_stack_size configured tx_task stack, 0 with CONFIG_CRSF_UART_DIRECT_ISR
+ * @param rx_buffer_size rx_task read buffer
+ * @param uart_rx_ring_size UART receive ring, part of uart_backend_size
+ * @param uart_tx_ring_size transmit frame queue, part of uart_backend_size; there is no UART TX ring
+ * @param uart_backend_size everything the UART backend takes besides the tx_task stack: rings, frame queue, driver state, event queue, interrupt handler, tx_task control block
+ * @param crc_size CRC tables
+ * @param core_state_size channel snapshot, parser, rate estimator, subscribers and configuration
+ * @param rtos_objects_size rx_task control block, mutex, exit semaphore and failsafe timer
+ * @param total sum of the stacks, rx_buffer_size, uart_backend_size, crc_size, core_state_size and rtos_objects_size
+ */
+typedef struct
 {
-    uint8_t byte0;
-    uint8_t byte1;
-    uint8_t byte2;
-} int24_t;
-// Helper functions to convert between int32_t and int24_t
-static inline int32_t int24_to_int32(int24_t val)
+    uint32_t rx_task_stack_size;
+    uint32_t rx_task_stack_free_min;
+    uint32_t tx_task_stack_size;
+    uint32_t rx_buffer_size;
+    uint32_t uart_rx_ring_size;
+    uint32_t uart_tx_ring_size;
+    uint32_t uart_backend_size;
+    uint32_t crc_size;
+    uint32_t core_state_size;
+    uint32_t rtos_objects_size;
+    uint32_t total;
+} crsf_memory_report_t;
+
+/**
+ * @brief transmit statistics
+ *
+ * @param frames frames written to the UART
+ * @param dropped frames dropped because CONFIG_CRSF_TX_QUEUE_SLOTS frames were already waiting
+ * @param max_depth most frames waiting in the queue at once
+ */
+typedef struct
 {
-    int32_t result = (val.byte2 << 16) | (val.byte1 << 8) | val.byte0;
-    // Sign extend if negative (bit 23 is set)
-    if (result & 0x800000)
-    {
-        result |= 0xFF000000;
-    }
-    return result;
-}
+    uint32_t frames;
+    uint32_t dropped;
+    uint32_t max_depth;
+} crsf_tx_stats_t;
 
-static inline int24_t int32_to_int24(int32_t val)
+/**
+ * @brief stack usage of one task
+ *
+ * @param running false if the task does not exist (yet)
+ * @param stack_size configured stack size in bytes
+ * @param stack_free_min smallest stack reserve in bytes so far (high-water mark)
+ */
+typedef struct
 {
-    int24_t result;
-    result.byte0 = val & 0xFF;
-    result.byte1 = (val >> 8) & 0xFF;
-    result.byte2 = (val >> 16) & 0xFF;
-    return result;
-}
+    bool running;
+    uint32_t stack_size;
+    uint32_t stack_free_min;
+} crsf_task_stack_t;
 
 /**
- * @brief struct for RPM data telemetry
+ * @brief stack usage of the tasks that run component code
  *
- * @param rpm_source_id identifies the source of the RPM data (e.g., 0 = Motor 1, 1 = Motor 2, etc.)
- * @param rpm_value array of 1 - 19 RPM values with negative ones representing the motor spinning in reverse
+ * @param rx_task receive task: parser, channel publishing, inputs and output updates
+ * @param tx_task transmit task of the UART driver backend, not running with CONFIG_CRSF_UART_DIRECT_ISR
+ * @param timer_task FreeRTOS timer service task: failsafe and command retry callbacks
+ * @param esp_timer_task esp_timer task: phase lock, low-power windows and the PPM output
+ */
+typedef struct
+{
+    crsf_task_stack_t rx_task;
+    crsf_task_stack_t tx_task;
+    crsf_task_stack_t timer_task;
+    crsf_task_stack_t esp_timer_task;
+} crsf_stack_report_t;
+
+/**
+ * @brief phase lock of a consumer task to the RC frame arrivals, see CRSF_phase_lock_wait
  *
+ * @param offset_us wake-up offset from the predicted frame arrival, negative wakes before it
+ * @param locked true while wake-ups follow the predicted arrivals, false while falling back to frame events
+ * @param wakes number of returns from CRSF_phase_lock_wait
+ * @param phase_error_us difference between the last wake-up and its target time
+ * @param input_age_us average age of the newest channels at wake-up
  */
-typedef struct __attribute__((packed))
+typedef struct
+{
+    int32_t offset_us;
+    bool locked;
+    uint32_t wakes;
+    int32_t phase_error_us;
+    uint32_t input_age_us;
+    // internal
+    TaskHandle_t task;
+    esp_timer_handle_t timer;
+    int64_t anchor_us;
+    int64_t last_target_us;
+} crsf_phase_lock_t;
+
+typedef enum
 {
-    uint8_t rpm_source_id; // Identifies the source of the RPM data (e.g., 0 = Motor 1, 1 = Motor 2, etc.)
-    int24_t rpm_value[];   // 1 - 19 RPM values with negative ones representing the motor spinning in reverse
-} crsf_rpm_t;
+    CRSF_COMMAND_ACCEPTED, // acknowledged and executed
+    CRSF_COMMAND_REJECTED, // acknowledged but not executed
+    CRSF_COMMAND_TIMEOUT   // no acknowledgement after all retries
+} crsf_command_result_t;
 
 /**
- * @brief struct for temperature data telemetry
+ * @brief completion callback of CRSF_send_command, runs in rx_task or the timer service task and must not block
+ */
+typedef void (*crsf_command_callback_t)(uint8_t command, uint8_t subcommand, crsf_command_result_t result, void *ctx);
+
+/**
+ * @brief command to send with CRSF_send_command
  *
- * @param temp_source_id identifies the source of the temperature data (e.g., 0 = FC including all ESCs, 1 = Ambient, etc.)
- * @param temp_value array of up to 20 temperature values in deci-degree (tenths of a degree) Celsius (e.g., 250 = 25.0°C, -50 = -5.0°C)
+ * @param dest device the command is addressed to
+ * @param command command id, see crsf_command_id_t
+ * @param subcommand subcommand id
+ * @param payload command payload, copied
+ * @param payload_length payload length, at most CRSF_COMMAND_MAX_PAYLOAD_SIZE
+ * @param retries number of resends while no ack arrives
+ * @param retry_interval_ms time to wait for an ack per attempt, 0 uses CONFIG_CRSF_COMMAND_RETRY_MS
+ * @param callback called once with the result, may be NULL
+ * @param ctx passed to the callback
+ */
+typedef struct
+{
+    crsf_dest_t dest;
+    uint8_t command;
+    uint8_t subcommand;
+    const void *payload;
+    uint8_t payload_length;
+    uint8_t retries;
+    uint16_t retry_interval_ms;
+    crsf_command_callback_t callback;
+    void *ctx;
+} crsf_command_request_t;
+
+/**
+ * @brief MAVLink tunnel counters
  *
+ * @param rx_packets packets reassembled and queued for CRSF_mavlink_read
+ * @param rx_dropped packets dropped because of missing or out of order chunks
+ * @param rx_overflows packets dropped because the receive buffer was full or the packet too long
+ * @param tx_packets packets sent completely
+ * @param tx_frames envelope frames queued for transmission
  */
-typedef struct __attribute__((packed))
+typedef struct
 {
-    uint8_t temp_source_id; // Identifies the source of the temperature data (e.g., 0 = FC including all ESCs, 1 = Ambient, etc.)
-    int16_t temp_value[];   // up to 20 temperature values in deci-degree (tenths of a degree) Celsius (e.g., 250 = 25.0°C, -50 = -5.0°C)
-} crsf_temp_t;
+    uint32_t rx_packets;
+    uint32_t rx_dropped;
+    uint32_t rx_overflows;
+    uint32_t tx_packets;
+    uint32_t tx_frames;
+} crsf_mavlink_stats_t;
 
 /**
- * @brief struct for link statistics received from the transmitter
- * @param up_rssi_ant1 Uplink RSSI Antenna 1 (dBm * -1)
- * @param up_rssi_ant2 Uplink RSSI Antenna 2 (dBm * -1)
- * @param up_link_quality Uplink Package success rate / Link quality (%)
- * @param up_snr Uplink SNR (dB)
- * @param active_antenna number of currently best antenna
- * @param rf_profile enum {4fps = 0 , 50fps, 150fps}
- * @param up_rf_power enum {0mW = 0, 10mW, 25mW, 100mW,
+ * @brief low-power mode statistics since CRSF_low_power_start
  *
- * @param down_rssi Downlink RSSI (dBm * -1)
- * @param down_link_quality Downlink Package success rate / Link quality (%)
- * @param down_snr Downlink SNR (dB)
+ * @param windows predicted frame windows the chip was kept awake for
+ * @param windows_missed windows closed without a channels frame
+ * @param frames channels frames decoded inside a window
+ * @param wake_to_decode_avg_us average time from opening a window to the decoded frame
+ * @param wake_to_decode_max_us maximum time from opening a window to the decoded frame
+ * @param awake_permille share of the time light sleep was blocked, in 1/1000
  */
-typedef struct __attribute__((packed))
+typedef struct
 {
-    uint8_t up_rssi_ant1;    // Uplink RSSI Antenna 1 (dBm * -1)
-    uint8_t up_rssi_ant2;    // Uplink RSSI Antenna 2 (dBm * -1)
-    uint8_t up_link_quality; // Uplink Package success rate / Link quality (%)
-    int8_t up_snr;           // Uplink SNR (dB)
-    uint8_t active_antenna;  // number of currently best antenna
-    uint8_t rf_profile;      // enum {4fps = 0 , 50fps, 150fps}
-    uint8_t up_rf_power;     // enum {0mW = 0, 10mW, 25mW, 100mW,
-    uint8_t down_rssi;         // Downlink RSSI (dBm * -1)
-    uint8_t down_link_quality; // Downlink Package success rate / Link quality (%)
-    int8_t down_snr;           // Downlink SNR (dB)
-} crsf_link_statistics_t;
+    uint32_t windows;
+    uint32_t windows_missed;
+    uint32_t frames;
+    uint32_t wake_to_decode_avg_us;
+    uint32_t wake_to_decode_max_us;
+    uint32_t awake_permille;
+} crsf_low_power_stats_t;
+
+#define CRSF_OUTPUT_MAX_PWM 8
 
+/**
+ * @brief what the outputs do when the link enters failsafe
+ */
 typedef enum
 {
-    CRSF_TYPE_CHANNELS = 0x16,
-    CRSF_TYPE_BATTERY = 0x08,
-    CRSF_TYPE_GPS = 0x02,
-    CRSF_TYPE_ALTITUDE = 0x09,
-    CRSF_TYPE_ATTITUDE = 0x1E,
-    CRSF_TYPE_RPM = 0x0C,
-    CRSF_TYPE_TEMP = 0x0D,
-    CRSF_TYPE_LINK_STATISTICS = 0x14
-} crsf_type_t;
+    CRSF_OUTPUT_FAILSAFE_HOLD,      // keep the last received values
+    CRSF_OUTPUT_FAILSAFE_PRESET,    // switch to failsafe_us
+    CRSF_OUTPUT_FAILSAFE_NO_PULSES  // stop PWM and PPM pulses and SBUS frames
+} crsf_output_failsafe_t;
 
-typedef enum
+/**
+ * @brief configuration of the channel outputs
+ *
+ * @param num_pwm number of entries used in pwm_pins, one LEDC channel each
+ * @param pwm_pins output pin of channel i, -1 for none
+ * @param pwm_rate_hz PWM frame rate, 0 for 50 Hz
+ * @param ppm_pin PPM output pin (RMT), -1 to disable
+ * @param ppm_channels number of channels in the PPM frame, 1-16
+ * @param sbus_pin SBUS output pin, -1 to disable
+ * @param sbus_uart UART used for SBUS, must not be the CRSF UART
+ * @param failsafe failsafe policy
+ * @param failsafe_us pulse widths of channels 1-16 for CRSF_OUTPUT_FAILSAFE_PRESET, also output before the first frame; 0 for 1500; with the other policies nothing is output before the first frame
+ */
+typedef struct
 {
-    CRSF_DEST_FC = 0xC8,
-    CRSF_DEST_RADIO = 0xEA
-} crsf_dest_t;
+    uint8_t num_pwm;
+    int8_t pwm_pins[CRSF_OUTPUT_MAX_PWM];
+    uint16_t pwm_rate_hz;
+    int8_t ppm_pin;
+    uint8_t ppm_channels;
+    int8_t sbus_pin;
+    uart_port_t sbus_uart;
+    crsf_output_failsafe_t failsafe;
+    uint16_t failsafe_us[16];
+} crsf_output_config_t;
+
+/**
+ * @brief channel output statistics
+ *
+ * @param updates channels frames applied to the outputs
+ * @param failsafes failsafe policy applications
+ * @param update_latency_avg_us average time from decoding a channels frame to all outputs being updated
+ * @param update_latency_max_us maximum of the same
+ */
+typedef struct
+{
+    uint32_t updates;
+    uint32_t failsafes;
+    uint32_t update_latency_avg_us;
+    uint32_t update_latency_max_us;
+} crsf_output_stats_t;
+
+/**
+ * @brief fill callback of a telemetry source
+ *
+ * Called from rx_task right before the frame is sent, must return quickly
+ * and must not block.
+ *
+ * @param payload where to write the payload, in wire format (big-endian fields)
+ * @param max_length room in payload, CRSF_MAX_PAYLOAD_SIZE
+ * @param ctx context given at registration
+ * @return size_t payload length, 0 if there is nothing new to send
+ */
+typedef size_t (*crsf_sensor_fill_t)(uint8_t *payload, size_t max_length, void *ctx);
+
+/**
+ * @brief telemetry source pulled by the telemetry scheduler
+ *
+ * @param type frame type the payload is sent as
+ * @param dest destination address, CRSF_DEST_FC for telemetry to the radio
+ * @param rate_hz desired frame rate
+ * @param fill callback writing the payload
+ * @param ctx passed through to fill
+ */
+typedef struct
+{
+    crsf_type_t type;
+    crsf_dest_t dest;
+    uint16_t rate_hz;
+    crsf_sensor_fill_t fill;
+    void *ctx;
+} crsf_sensor_source_t;
+
+/**
+ * @brief ESC telemetry aggregator configuration
+ *
+ * Motors beyond CRSF_RPM_MAX_VALUES (RPM) or CRSF_TEMP_MAX_VALUES
+ * (temperature) are sent in further frames with source ids counting up from
+ * source_id.
+ *
+ * @param num_motors number of motors, 1 to CONFIG_CRSF_ESC_MAX_MOTORS
+ * @param source_id source id of the first RPM and temperature frame
+ * @param dest destination address, CRSF_DEST_FC for telemetry to the radio
+ * @param rpm_rate_hz RPM updates per second for every motor, 0 to send no RPM frames
+ * @param temp_rate_hz temperature updates per second for every motor, 0 to send no temperature frames
+ */
+typedef struct
+{
+    uint8_t num_motors;
+    uint8_t source_id;
+    crsf_dest_t dest;
+    uint16_t rpm_rate_hz;
+    uint16_t temp_rate_hz;
+} crsf_esc_telemetry_config_t;
+
+#define CRSF_TELEMETRY_MAX_TYPES 8
+
+/**
+ * @brief downlink budget of the telemetry rate controller
+ *
+ * The budget is packet rate / telemetry_ratio * bytes_per_packet, reduced by
+ * headroom_percent, and follows packet rate changes.
+ *
+ * @param telemetry_ratio telemetry ratio of the link, N for 1:N
+ * @param bytes_per_packet telemetry bytes carried per downlink packet, 0 for 5 (ELRS 4 byte OTA packets)
+ * @param headroom_percent share of the budget kept free for frames the controller does not see
+ * @param bytes_per_second fixed budget instead of the computed one, 0 to compute
+ */
+typedef struct
+{
+    uint16_t telemetry_ratio;
+    uint8_t bytes_per_packet;
+    uint8_t headroom_percent;
+    uint32_t bytes_per_second;
+} crsf_telemetry_budget_config_t;
+
+/**
+ * @brief per-type telemetry statistics
+ *
+ * @param type frame type
+ * @param weight share of the budget when types compete for it
+ * @param allowed_bytes_per_s current allocation
+ * @param demand_bytes_per_s rate the application tries to send at
+ * @param frames_sent frames passed to the UART
+ * @param frames_dropped frames dropped for lack of budget
+ */
+typedef struct
+{
+    uint8_t type;
+    uint8_t weight;
+    uint32_t allowed_bytes_per_s;
+    uint32_t demand_bytes_per_s;
+    uint32_t frames_sent;
+    uint32_t frames_dropped;
+} crsf_telemetry_type_stats_t;
+
+/**
+ * @brief telemetry rate controller statistics
+ *
+ * @param budget_bytes_per_s current downlink budget
+ * @param num_types number of entries used in types
+ * @param types statistics of each telemetry type seen so far
+ */
+typedef struct
+{
+    uint32_t budget_bytes_per_s;
+    uint8_t num_types;
+    crsf_telemetry_type_stats_t types[CRSF_TELEMETRY_MAX_TYPES];
+} crsf_telemetry_budget_stats_t;
+
+/**
+ * @brief loopback self-test configuration
+ *
+ * @param internal_loopback route TX to RX inside the UART, otherwise TX has to be jumpered to RX
+ * @param duration_ms how long frames are sent at each baud rate
+ * @param baud_rates baud rates to test, NULL tests all rates supported by ELRS receivers
+ * @param num_baud_rates number of entries in baud_rates
+ */
+typedef struct
+{
+    bool internal_loopback;
+    uint32_t duration_ms;
+    const uint32_t *baud_rates;
+    size_t num_baud_rates;
+} crsf_selftest_config_t;
+
+/**
+ * @brief self-test result for one baud rate
+ *
+ * @param baud_rate tested baud rate
+ * @param frames_sent frames accepted by the transmitter, self-test frames bypass the telemetry budget
+ * @param frames_received frames parsed by rx_task
+ * @param frames_lost gaps in the received sequence numbers
+ * @param crc_errors frames rejected by the parser because of a bad CRC
+ * @param dropped_bytes bytes discarded by the parser while resynchronising
+ * @param frames_per_second received frames per second
+ * @param rx_task_cpu_percent CPU time used by rx_task, -1 if FreeRTOS run time stats are disabled
+ */
+typedef struct
+{
+    uint32_t baud_rate;
+    uint32_t frames_sent;
+    uint32_t frames_received;
+    uint32_t frames_lost;
+    uint32_t crc_errors;
+    uint32_t dropped_bytes;
+    uint32_t frames_per_second;
+    int8_t rx_task_cpu_percent;
+} crsf_selftest_result_t;
 
 /**
  * @brief setup CRSF communication
  *
+ * Does nothing but log an error if already initialized, call CRSF_deinit first.
+ *
  * @param config pointer to config of CRSF communication
  */
 void CRSF_init(crsf_config_t *config);
 
+/**
+ * @brief stop CRSF communication and release the task, timers and UART driver
+ *
+ * Channel outputs and ESC telemetry are stopped and all telemetry sources
+ * are unregistered as well.
+ *
+ * Subscribers get a last CRSF_EVENT_FAILSAFE. Afterwards the getters keep
+ * returning the last values with CRSF_is_failsafe true; any other CRSF
+ * function may only be called again after CRSF_init. The mutex is kept for
+ * the next CRSF_init.
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_STATE if not initialized
+ */
+esp_err_t CRSF_deinit(void);
+
+/**
+ * @brief switch baud rate, pins or UART while running
+ *
+ * Published channels, link statistics, the frame rate estimate, subscriptions
+ * and the failsafe timer are kept, so consumers only see a gap in the frames.
+ * A baud rate or pin change only reprograms the UART; a different UART
+ * restarts rx_task on the new driver. Latency measurement is stopped when the
+ * rx pin or UART change. If the new input cannot be started the previous one
+ * is restored; if that fails as well, the component is left deinitialized.
+ *
+ * @param config pointer to the new configuration
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_STATE if not initialized, or the UART driver error; the error
+ *         of the restore if the component was left deinitialized
+ */
+esp_err_t CRSF_reconfigure(const crsf_config_t *config);
+
 /**
  * @brief copy latest 16 channel data received to the pointer
  *
@@ -201,6 +580,17 @@ void CRSF_init(crsf_config_t *config);
  */
 void CRSF_receive_channels(crsf_channels_t *channels);
 
+/**
+ * @brief function sends payload to a destination using uart
+ *
+ * @param payload pointer to payload of given crsf_type_t
+ * @param destination destination for payload, typically CRSF_DEST_FC
+ * @param type type of data contained in payload
+ * @param payload_length length of the payload type
+ */
+void CRSF_send_payload(const void *payload, crsf_dest_t destination, crsf_type_t type, uint8_t payload_length);
+
+#if CONFIG_CRSF_TX_BATTERY
 /**
  * @brief send battery data telemetry
  *
@@ -208,24 +598,510 @@ void CRSF_receive_channels(crsf_channels_t *channels);
  * @param payload pointer to the battery data
  */
 void CRSF_send_battery_data(crsf_dest_t dest, crsf_battery_t *payload);
+#endif
 
+#if CONFIG_CRSF_TX_GPS
 /**
  * @brief send gps data telemetry
  *
+ * The fields must already be in wire units (see crsf_gps_t) and are byte
+ * swapped in place. CRSF_send_gps takes SI units instead.
+ *
  * @param dest destination (to send back to transmitter destination is CRSF_DEST_FC)
  * @param payload pointer to the gps data
  */
 void CRSF_send_gps_data(crsf_dest_t dest, crsf_gps_t *payload);
 
+/**
+ * @brief send GPS telemetry given in SI units
+ *
+ * Scaling, rounding, saturation and byte order are handled here, see
+ * crsf_encode_gps. A telemetry source can call crsf_encode_gps in its fill
+ * callback for the same encoding.
+ *
+ * @param dest destination, CRSF_DEST_FC for telemetry to the radio
+ * @param fix pointer to the fix
+ */
+void CRSF_send_gps(crsf_dest_t dest, const crsf_gps_fix_t *fix);
+#endif
+
+#if CONFIG_CRSF_TX_RPM
 void CRSF_send_rpm_values(crsf_dest_t dest, uint8_t source_id, int32_t *rpm_values, size_t num_values);
+#endif
 
-void CRSF_send_temp_data(crsf_dest_t dest, crsf_temp_t *payload, size_t num_temps);
+#if CONFIG_CRSF_TX_TEMP
+/**
+ * @brief send temperature telemetry, split into frames of up to CRSF_TEMP_MAX_VALUES values
+ *
+ * The first frame uses payload->temp_source_id, each further frame the next
+ * source id, so more than CRSF_TEMP_MAX_VALUES values occupy several source
+ * ids on the receiver. The payload is not modified. With num_temps 0 nothing
+ * is sent; earlier versions sent a frame carrying only the source id.
+ *
+ * @param dest destination (to send back to transmitter destination is CRSF_DEST_FC)
+ * @param payload pointer to the source id and num_temps values in deci-degree Celsius
+ * @param num_temps number of temperature values, any number
+ */
+void CRSF_send_temp_data(crsf_dest_t dest, const crsf_temp_t *payload, size_t num_temps);
+
+/**
+ * @brief send temperatures from a plain array, split like CRSF_send_temp_data
+ *
+ * @param dest destination, CRSF_DEST_FC for telemetry to the radio
+ * @param source_id source id of the first frame, further frames count up from it
+ * @param deci_celsius temperatures in 0.1 degree Celsius
+ * @param count number of values, any number; 0 sends nothing
+ */
+void CRSF_send_temps(crsf_dest_t dest, uint8_t source_id, const int16_t *deci_celsius, size_t count);
+#endif
 
 bool CRSF_is_failsafe();
 
+/**
+ * @brief get the estimated RC frame rate
+ *
+ * @param rate pointer receiving the estimate
+ * @return true if an estimate is available, false before enough frames were received
+ */
+bool CRSF_get_frame_rate(crsf_frame_rate_t *rate);
+
+/**
+ * @brief get the transmit statistics
+ *
+ * Any task may send at any time and frames stay whole. Senders put frames
+ * into a lock-free queue and never wait; a single consumer writes them to the
+ * UART, the UART interrupt with CONFIG_CRSF_UART_DIRECT_ISR, otherwise
+ * tx_task. A full queue drops the frame.
+ *
+ * @param stats pointer receiving the statistics
+ */
+void CRSF_get_tx_stats(crsf_tx_stats_t *stats);
+
+/**
+ * @brief report the RAM used by the receive path
+ *
+ * Run the application under its real load before reading the stack reserve,
+ * the high-water mark only covers what rx_task has executed so far.
+ *
+ * @param report pointer receiving the report
+ */
+void CRSF_get_memory_report(crsf_memory_report_t *report);
+
+/**
+ * @brief report the stack high-water marks of the tasks running component code
+ *
+ * The timer tasks are shared with the rest of the application, their figures
+ * include its callbacks. Like CRSF_get_memory_report, only meaningful after
+ * running under the real load. Finding the esp_timer task walks the task list,
+ * call it for diagnostics, not from a control loop.
+ *
+ * @param report pointer receiving the report
+ */
+void CRSF_get_stack_report(crsf_stack_report_t *report);
+
+/**
+ * @brief derive the failsafe timeout from the estimated frame rate
+ *
+ * The timeout is recalculated whenever the estimate locks or the packet rate
+ * changes. Until then, and with missed_frames 0, CONFIG_CRSF_FAILSAFE_TIMEOUT_MS is used.
+ * The derived timeout is capped at 60 s.
+ *
+ * @param missed_frames enter failsafe after this many frame intervals without an RC frame, 0 disables
+ * @param min_timeout_ms lower bound of the derived timeout
+ */
+void CRSF_set_failsafe_auto(uint16_t missed_frames, uint16_t min_timeout_ms);
+
+#if CONFIG_CRSF_CHANNEL_FILTER
+/**
+ * @brief prepare a channel smoothing filter, each consumer task keeps its own
+ *
+ * @param filter pointer to the filter state
+ * @param config pointer to the filter configuration
+ */
+void CRSF_filter_init(crsf_filter_t *filter, const crsf_filter_config_t *config);
+
+/**
+ * @brief get the smoothed channel values for the current time
+ *
+ * Call once per iteration of the consumer loop; new frames and frame rate
+ * changes are picked up automatically.
+ *
+ * @param filter pointer to the filter state
+ * @param values receives 16 channel values
+ */
+void CRSF_filter_channels(crsf_filter_t *filter, uint16_t *values);
+#endif
+
+#if CONFIG_CRSF_PHASE_LOCK
+/**
+ * @brief prepare phase-locked scheduling for the calling task
+ *
+ * The task is subscribed to CRSF_EVENT_CHANNELS and CRSF_EVENT_PHASE_WAKE.
+ *
+ * @param lock pointer to the phase lock state, must stay valid until CRSF_phase_lock_deinit
+ * @param offset_us wake-up offset from the predicted frame arrival, negative wakes before it
+ * @return esp_err_t ESP_OK or the error creating the wake-up timer
+ */
+esp_err_t CRSF_phase_lock_init(crsf_phase_lock_t *lock, int32_t offset_us);
+
+/**
+ * @brief block until offset_us after the next predicted RC frame arrival
+ *
+ * Arrivals are predicted from the frame rate estimate and a phase anchor that
+ * follows the measured arrival times, so a control loop calling this once per
+ * iteration runs at the packet rate with a fixed phase to the RC frames. Until
+ * the rate estimate is available, and in failsafe, it returns on the next
+ * channels frame instead.
+ *
+ * @param lock pointer to the phase lock state
+ * @param timeout maximum time to wait in ticks
+ * @return esp_err_t ESP_OK, ESP_ERR_TIMEOUT
+ */
+esp_err_t CRSF_phase_lock_wait(crsf_phase_lock_t *lock, TickType_t timeout);
+
+/**
+ * @brief release the wake-up timer
+ *
+ * @param lock pointer to the phase lock state
+ */
+void CRSF_phase_lock_deinit(crsf_phase_lock_t *lock);
+#endif
+
+/**
+ * @brief notify the calling task about the given events
+ *
+ * Events are delivered with xTaskNotify (eSetBits) on notification index 0,
+ * so the task should not use that notification value for anything else.
+ *
+ * @param events mask of crsf_event_t
+ * @return esp_err_t ESP_OK, ESP_ERR_NO_MEM if CRSF_MAX_SUBSCRIBERS tasks are already subscribed
+ */
+esp_err_t CRSF_subscribe(uint32_t events);
+
+/**
+ * @brief stop notifying the calling task
+ */
+void CRSF_unsubscribe(void);
+
+/**
+ * @brief block the calling (subscribed) task until one of the events occurs
+ *
+ * @param events mask of crsf_event_t to wait for
+ * @param timeout maximum time to wait in ticks
+ * @return uint32_t events that occurred, 0 on timeout
+ */
+uint32_t CRSF_wait_event(uint32_t events, TickType_t timeout);
+
+/**
+ * @brief wait for the next channel frame and copy it, subscribes the calling task on first use
+ *
+ * @param channels pointer to receiver buffer
+ * @param timeout maximum time to wait in ticks
+ * @return true new channels were copied, false on timeout
+ */
+bool CRSF_wait_channels(crsf_channels_t *channels, TickType_t timeout);
+
+#if CONFIG_CRSF_COMMANDS
+/**
+ * @brief send a command frame without blocking
+ *
+ * The frame is sent right away; resends and the wait for the ack run in the
+ * background and the result is reported through the callback.
+ *
+ * @param request pointer to the command, only used during the call
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_SIZE, ESP_ERR_NO_MEM if CONFIG_CRSF_COMMAND_MAX_PENDING commands are in flight
+ */
+esp_err_t CRSF_send_command(const crsf_command_request_t *request);
+#endif
+
+#if CONFIG_CRSF_MAVLINK
+/**
+ * @brief read tunneled MAVLink bytes received in envelope frames
+ *
+ * Only complete packets are queued, so the stream never contains partial packets.
+ *
+ * @param data receive buffer
+ * @param max_length size of the receive buffer
+ * @param timeout maximum time to wait for data in ticks
+ * @return size_t number of bytes read, 0 on timeout
+ */
+size_t CRSF_mavlink_read(void *data, size_t max_length, TickType_t timeout);
+
+/**
+ * @brief send a MAVLink packet in envelope frames
+ *
+ * The packet is split into chunks of up to CRSF_MAVLINK_CHUNK_SIZE bytes which
+ * are written straight into the frames; chunks of concurrent writers are not
+ * interleaved. While the transmit queue is full the call waits for it, for up
+ * to 20 ms per chunk. If a chunk still cannot be queued the rest of the packet
+ * is not sent and the peer discards the chunks it got; send the packet again.
+ *
+ * @param data packet bytes
+ * @param length packet length, at most CRSF_MAVLINK_MAX_CHUNKS * CRSF_MAVLINK_CHUNK_SIZE
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_SIZE, ESP_ERR_INVALID_STATE without a CRSF input or ESP_ERR_TIMEOUT if a chunk was dropped
+ */
+esp_err_t CRSF_mavlink_write(const void *data, size_t length);
+
+/**
+ * @brief get the MAVLink tunnel counters
+ *
+ * @param stats pointer receiving the counters
+ */
+void CRSF_mavlink_get_stats(crsf_mavlink_stats_t *stats);
+#endif
+
+#if CONFIG_CRSF_LOW_POWER
+/**
+ * @brief let the chip light sleep between RC frames
+ *
+ * Needs power management with automatic light sleep enabled (esp_pm_configure).
+ * Light sleep is blocked from CONFIG_CRSF_LOW_POWER_GUARD_US before each
+ * predicted channels frame until it is decoded, so wake-to-decode latency stays
+ * within the guard time plus the frame jitter. When frames stop, the chip sleeps
+ * until UART activity wakes it; the frame that wakes it is lost. Stopped by
+ * CRSF_deinit and when CRSF_reconfigure changes the UART.
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_STATE before CRSF_init, ESP_ERR_NOT_SUPPORTED with PPM input, or the error
+ *         configuring UART wakeup (not every UART can wake the chip)
+ */
+esp_err_t CRSF_low_power_start(void);
+
+/**
+ * @brief keep the chip awake again
+ */
+void CRSF_low_power_stop(void);
+
+/**
+ * @brief get the low-power mode statistics
+ *
+ * @param stats pointer receiving the statistics
+ */
+void CRSF_low_power_get_stats(crsf_low_power_stats_t *stats);
+#endif
+
+#if CONFIG_CRSF_OUTPUT
+/**
+ * @brief mirror the received channels to PWM, PPM and SBUS outputs
+ *
+ * Outputs are updated from rx_task as soon as a channels frame is decoded, the
+ * pulse timing is generated by the LEDC, RMT and UART peripherals. A PWM
+ * update takes effect at the start of the next PWM period, PPM values go out
+ * with the next PPM frame (22.5 ms) and SBUS frames are sent with each channels
+ * frame, limited to one per SBUS frame time. On failsafe the configured
+ * policy is applied once; SBUS frames carry the failsafe flag. Restarts the
+ * outputs if already running.
+ *
+ * @param config pointer to the output configuration
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG or the error of the peripheral setup
+ */
+esp_err_t CRSF_output_start(const crsf_output_config_t *config);
+
+/**
+ * @brief stop all outputs and release the peripherals
+ */
+void CRSF_output_stop(void);
+
+/**
+ * @brief get the output statistics
+ *
+ * @param stats pointer receiving the statistics
+ */
+void CRSF_output_get_stats(crsf_output_stats_t *stats);
+#endif
+
+#if CONFIG_CRSF_CHANNEL_HISTORY
+/**
+ * @brief cursor that makes CRSF_channel_history_read return only frames received from now on
+ *
+ * Start every reader from this cursor. Sequence numbers continue across
+ * CRSF_deinit and CRSF_init, which keeps cursors held over a restart valid;
+ * a cursor of 0 is the first frame only until the first restart.
+ *
+ * @return uint32_t sequence number of the next channels frame
+ */
+uint32_t CRSF_channel_history_cursor(void);
+
+/**
+ * @brief read every channels frame received since the cursor, oldest first
+ *
+ * The last CONFIG_CRSF_CHANNEL_HISTORY_SIZE frames are kept, a reader must
+ * come back before that many frames arrived to see all of them. Each reader
+ * keeps its own cursor.
+ *
+ * @param cursor sequence number of the next frame to read, advanced past the frames returned
+ * @param samples array receiving the frames
+ * @param max_samples size of the array, call again if it was filled
+ * @param lost receives the number of frames overwritten before they could be read, may be NULL
+ * @return size_t number of frames written to samples
+ */
+size_t CRSF_channel_history_read(uint32_t *cursor, crsf_channel_sample_t *samples, size_t max_samples, uint32_t *lost);
+#endif
+
+#if CONFIG_CRSF_SENSOR_SOURCES
+/**
+ * @brief register a telemetry source
+ *
+ * After every channels frame rx_task asks the most overdue source for a
+ * payload and sends it, at most one frame per channels frame, so data is
+ * read just before it goes out instead of waiting in a queue. A source is
+ * due rate_hz times per second, as far as the packet rate and the telemetry
+ * budget (CRSF_telemetry_budget_start) allow. CRSF input only.
+ *
+ * @param source pointer to the source, copied
+ * @param id receives the id for CRSF_sensor_unregister
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_NO_MEM if CONFIG_CRSF_SENSOR_MAX_SOURCES sources are registered
+ */
+esp_err_t CRSF_sensor_register(const crsf_sensor_source_t *source, int *id);
+
+/**
+ * @brief remove a telemetry source, its fill callback is not running once this returns
+ *
+ * May be called from a fill callback, for its own source or any other one;
+ * the callback then running finishes normally and is not called again.
+ *
+ * @param id id from CRSF_sensor_register
+ * @return esp_err_t ESP_OK or ESP_ERR_INVALID_ARG
+ */
+esp_err_t CRSF_sensor_unregister(int id);
+#endif
+
+#if CONFIG_CRSF_ESC_TELEMETRY
+/**
+ * @brief start sending ESC telemetry collected with CRSF_esc_set_rpm and CRSF_esc_set_temp
+ *
+ * Registers an RPM and a temperature source with the telemetry scheduler.
+ * Each frame carries as many motors as fit (19 RPM or 20 temperatures), a
+ * frame is only sent when at least one of its motors was updated since the
+ * last one, the others repeat their last value.
+ *
+ * @param config pointer to the configuration, copied
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE if already running or ESP_ERR_NO_MEM if no source slots are free
+ */
+esp_err_t CRSF_esc_telemetry_start(const crsf_esc_telemetry_config_t *config);
+
+/**
+ * @brief stop sending ESC telemetry and forget the collected values
+ */
+void CRSF_esc_telemetry_stop(void);
+
+/**
+ * @brief store the RPM of one motor, callable from tasks and interrupts (e.g. a DShot telemetry decoder)
+ *
+ * @param motor motor index, below num_motors
+ * @param rpm RPM, negative when spinning in reverse
+ */
+void CRSF_esc_set_rpm(uint8_t motor, int32_t rpm);
+
+/**
+ * @brief store the temperature of one motor's ESC, callable from tasks and interrupts (e.g. a BLHeli telemetry decoder)
+ *
+ * @param motor motor index, below num_motors
+ * @param deci_celsius temperature in 0.1 degree Celsius
+ */
+void CRSF_esc_set_temp(uint8_t motor, int16_t deci_celsius);
+#endif
+
+#if CONFIG_CRSF_TELEMETRY_BUDGET
+/**
+ * @brief limit telemetry to the downlink budget
+ *
+ * Every frame sent through CRSF_send_payload and the telemetry encoders is
+ * charged to a token bucket of its type. Types that want less than their
+ * weighted share get what they ask for, the rest of the budget is split
+ * between the others by weight, so allocations follow the actual send rates
+ * and the packet rate. Frames beyond the allocation are dropped before they
+ * reach the receiver. Types are added on their first frame with weight 1.
+ *
+ * @param config pointer to the budget configuration
+ * @return esp_err_t ESP_OK or ESP_ERR_INVALID_ARG without a ratio or fixed budget
+ */
+esp_err_t CRSF_telemetry_budget_start(const crsf_telemetry_budget_config_t *config);
+
+/**
+ * @brief stop limiting telemetry, statistics are kept
+ */
+void CRSF_telemetry_budget_stop(void);
+
+/**
+ * @brief set the weight of a telemetry type
+ *
+ * @param type frame type
+ * @param weight share of the budget relative to the other types, at least 1
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG for weight 0 or ESP_ERR_NO_MEM if CRSF_TELEMETRY_MAX_TYPES types are in use
+ */
+esp_err_t CRSF_telemetry_set_weight(crsf_type_t type, uint8_t weight);
+
+/**
+ * @brief get the rate controller statistics
+ *
+ * @param stats pointer receiving the statistics
+ */
+void CRSF_telemetry_budget_get_stats(crsf_telemetry_budget_stats_t *stats);
+#endif
+
+#if CONFIG_CRSF_SELFTEST
+/**
+ * @brief loop frames from TX back to RX at maximum rate for each baud rate and report the results
+ *
+ * Must be called after CRSF_init. Channels are not updated while the test runs
+ * and the original baud rate is restored afterwards. Blocks for about
+ * duration_ms per baud rate.
+ *
+ * @param config pointer to the self-test configuration
+ * @param results array receiving one result per tested baud rate
+ * @param max_results size of the results array
+ * @return int number of results written, -1 if CRSF_init was not called or the input is not CRSF
+ */
+int CRSF_selftest(const crsf_selftest_config_t *config, crsf_selftest_result_t *results, size_t max_results);
+
+/**
+ * @brief log self-test results
+ *
+ * @param results results from CRSF_selftest
+ * @param num_results number of results
+ */
+void CRSF_selftest_print_results(const crsf_selftest_result_t *results, size_t num_results);
+#endif
+
+#if CONFIG_CRSF_LATENCY_MEASUREMENT
+/**
+ * @brief start end-to-end latency measurement, clears previous results
+ *
+ * The start of each channel frame is timestamped with an edge interrupt on the
+ * rx pin, which is only armed between frames. Stages end when rx_task wakes,
+ * the frame is parsed, the channels are published and a consumer reads them
+ * through CRSF_receive_channels or CRSF_wait_channels.
+ *
+ * @param config pointer to the measurement configuration
+ * @return esp_err_t ESP_OK, ESP_ERR_NOT_SUPPORTED if the input is not CRSF, or the error of the GPIO interrupt setup
+ */
+esp_err_t CRSF_latency_start(const crsf_latency_config_t *config);
+
+/**
+ * @brief stop latency measurement, the results are kept
+ */
+void CRSF_latency_stop(void);
+
+/**
+ * @brief copy the latency histograms
+ *
+ * @param report pointer to the report
+ */
+void CRSF_latency_get_report(crsf_latency_report_t *report);
+
+/**
+ * @brief log a latency report
+ *
+ * @param report pointer to the report
+ */
+void CRSF_latency_print_report(const crsf_latency_report_t *report);
+#endif
+
 /**
  * @brief get the latest link statistics received
  *
  * @return crsf_link_stats_rx_t the latest link statistics received
  */
 crsf_link_statistics_t CRSF_get_link_statistics();
+
+#endif /* ESP_CRSF_H */
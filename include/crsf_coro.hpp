@@ -0,0 +1,349 @@
+#ifndef CRSF_CORO_HPP
+#define CRSF_CORO_HPP
+
+#if __cplusplus < 202002L
+#error "crsf_coro.hpp needs C++20 (-std=gnu++20)"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <type_traits>
+
+extern "C" {
+#include "ESP_CRSF.h"
+}
+
+/*
+ * Optional C++20 coroutine facade. One task owns an event_loop, spawns any
+ * number of coroutines on it and calls run(). Each coroutine co_awaits the
+ * next channels frame, link statistics, failsafe change, telemetry slot or
+ * a delay; the loop sleeps in CRSF_wait_event on the task's notification
+ * bits and resumes the waiting coroutines, so concerns that would otherwise
+ * get a FreeRTOS task each share one task and one stack.
+ *
+ * Awaiters live in the coroutine frames and are linked into per-event
+ * lists, the only allocation is the coroutine frame itself. The loop and
+ * its coroutines must only be used from the task calling run().
+ *
+ *     crsf::task arm_logic(crsf::event_loop &loop)
+ *     {
+ *         for (;;) {
+ *             crsf_channels_t channels = co_await loop.next_channels();
+ *             ...
+ *             if (co_await loop.failsafe_change()) { ... }
+ *         }
+ *     }
+ *
+ *     crsf::event_loop loop;
+ *     loop.spawn(arm_logic(loop));
+ *     loop.run();
+ */
+
+namespace crsf
+{
+
+/**
+ * @brief fire-and-forget coroutine run by an event_loop
+ *
+ * The frame is freed when the coroutine returns. A task that is never
+ * spawned is destroyed with the task object.
+ */
+class task
+{
+public:
+    struct promise_type
+    {
+        task get_return_object() noexcept { return task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    task(task &&other) noexcept : handle_(other.handle_) { other.handle_ = nullptr; }
+    task(const task &) = delete;
+    task &operator=(const task &) = delete;
+    ~task()
+    {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+private:
+    friend class event_loop;
+
+    explicit task(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+
+    std::coroutine_handle<> release() noexcept
+    {
+        std::coroutine_handle<> handle = handle_;
+        handle_ = nullptr;
+        return handle;
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail
+{
+
+template <typename T>
+struct waiter
+{
+    waiter *next;
+    std::coroutine_handle<> handle;
+    T value;
+};
+
+template <>
+struct waiter<void>
+{
+    waiter *next;
+    std::coroutine_handle<> handle;
+};
+
+struct delay_waiter
+{
+    delay_waiter *next;
+    std::coroutine_handle<> handle;
+    TickType_t deadline;
+};
+
+// suspends until the loop resumes the list the awaiter was linked into
+template <typename T>
+class event_awaitable
+{
+public:
+    explicit event_awaitable(waiter<T> *&list) noexcept : list_(list) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) noexcept
+    {
+        node_.handle = handle;
+        node_.next = list_;
+        list_ = &node_;
+    }
+
+    T await_resume() const noexcept
+    {
+        if constexpr (!std::is_void_v<T>) {
+            return node_.value;
+        }
+    }
+
+private:
+    waiter<T> *&list_;
+    waiter<T> node_;
+};
+
+} // namespace detail
+
+/**
+ * @brief single-task scheduler of crsf::task coroutines driven by the CRSF events
+ */
+class event_loop
+{
+public:
+    event_loop() = default;
+    event_loop(const event_loop &) = delete;
+    event_loop &operator=(const event_loop &) = delete;
+
+    /**
+     * @brief start a coroutine, it runs until its first co_await before spawn returns
+     *
+     * @param coroutine coroutine to run, owned by the loop from now on
+     */
+    void spawn(task coroutine) { coroutine.release().resume(); }
+
+    /**
+     * @brief awaitable resuming with the next channels frame
+     *
+     * @return awaitable yielding crsf_channels_t
+     */
+    detail::event_awaitable<crsf_channels_t> next_channels() noexcept
+    {
+        return detail::event_awaitable<crsf_channels_t>(channels_waiters_);
+    }
+
+    /**
+     * @brief awaitable resuming with the next link statistics frame
+     *
+     * @return awaitable yielding crsf_link_statistics_t
+     */
+    detail::event_awaitable<crsf_link_statistics_t> next_link_statistics() noexcept
+    {
+        return detail::event_awaitable<crsf_link_statistics_t>(link_statistics_waiters_);
+    }
+
+    /**
+     * @brief awaitable resuming when failsafe is entered or left
+     *
+     * @return awaitable yielding true if the link is in failsafe now
+     */
+    detail::event_awaitable<bool> failsafe_change() noexcept
+    {
+        return detail::event_awaitable<bool>(failsafe_waiters_);
+    }
+
+    /**
+     * @brief awaitable resuming right after the next channels frame outside failsafe
+     *
+     * The receiver takes telemetry right after sending channels, so frames
+     * sent with the CRSF_send_* functions at this point go out without
+     * waiting. The telemetry budget still applies. CRSF input only.
+     *
+     * @return awaitable yielding nothing
+     */
+    detail::event_awaitable<void> telemetry_slot() noexcept
+    {
+        return detail::event_awaitable<void>(telemetry_waiters_);
+    }
+
+    /**
+     * @brief awaitable resuming after the given number of ticks, or on the next event after that
+     *
+     * @param ticks time to wait in ticks
+     * @return awaitable yielding nothing
+     */
+    auto delay(TickType_t ticks) noexcept
+    {
+        struct awaitable
+        {
+            event_loop &loop;
+            detail::delay_waiter node;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) noexcept
+            {
+                node.handle = handle;
+                loop.add_delay(&node);
+            }
+            void await_resume() const noexcept {}
+        };
+        return awaitable{*this, {nullptr, nullptr, xTaskGetTickCount() + ticks}};
+    }
+
+    /**
+     * @brief wait for one batch of events and resume the coroutines waiting for them
+     *
+     * Subscribes the calling task on first use, see CRSF_subscribe.
+     *
+     * @param timeout maximum time to wait in ticks, shortened to the next delay
+     * @return true if an event or a delay was handled, false on timeout or when no subscriber slot is free
+     */
+    bool poll(TickType_t timeout)
+    {
+        if (!subscribed_) {
+            if (CRSF_subscribe(EVENTS) != ESP_OK) {
+                return false;
+            }
+            subscribed_ = true;
+        }
+
+        if (delays_ != nullptr) {
+            TickType_t remaining = delays_->deadline - xTaskGetTickCount();
+            // deadline already passed if the difference wrapped around
+            if (static_cast<int32_t>(remaining) < 0) {
+                remaining = 0;
+            }
+            if (remaining < timeout) {
+                timeout = remaining;
+            }
+        }
+
+        uint32_t events = CRSF_wait_event(EVENTS, timeout);
+        if (events & CRSF_EVENT_FAILSAFE) {
+            bool failsafe = CRSF_is_failsafe();
+            resume_all(failsafe_waiters_, [&](auto &w) { w.value = failsafe; });
+        }
+        if (events & CRSF_EVENT_LINK_STATISTICS) {
+            crsf_link_statistics_t statistics = CRSF_get_link_statistics();
+            resume_all(link_statistics_waiters_, [&](auto &w) { w.value = statistics; });
+        }
+        if (events & CRSF_EVENT_CHANNELS) {
+            crsf_channels_t channels;
+            CRSF_receive_channels(&channels);
+            resume_all(channels_waiters_, [&](auto &w) { w.value = channels; });
+            // in failsafe the slot waiters keep waiting for a live frame
+            if (!CRSF_is_failsafe()) {
+                resume_all(telemetry_waiters_, [](auto &) {});
+            }
+        }
+        return resume_delays() || events != 0;
+    }
+
+    /**
+     * @brief run the loop in the calling task, never returns
+     */
+    [[noreturn]] void run()
+    {
+        for (;;) {
+            if (!poll(portMAX_DELAY) && !subscribed_) {
+                vTaskDelay(1); // no subscriber slot yet, retry
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t EVENTS = CRSF_EVENT_CHANNELS | CRSF_EVENT_LINK_STATISTICS | CRSF_EVENT_FAILSAFE;
+
+    // resumed coroutines may wait for the same event again, they go on a fresh list
+    template <typename T, typename F>
+    static void resume_all(detail::waiter<T> *&list, F &&fill)
+    {
+        detail::waiter<T> *w = list;
+        list = nullptr;
+        while (w != nullptr) {
+            detail::waiter<T> *next = w->next;
+            fill(*w);
+            w->handle.resume();
+            w = next;
+        }
+    }
+
+    // sorted by deadline
+    void add_delay(detail::delay_waiter *node) noexcept
+    {
+        detail::delay_waiter **pos = &delays_;
+        while (*pos != nullptr && static_cast<int32_t>((*pos)->deadline - node->deadline) <= 0) {
+            pos = &(*pos)->next;
+        }
+        node->next = *pos;
+        *pos = node;
+    }
+
+    // expired delays are unlinked first, a resumed coroutine may start a new one that is already due
+    bool resume_delays()
+    {
+        TickType_t now = xTaskGetTickCount();
+        detail::delay_waiter *expired = nullptr;
+        detail::delay_waiter **tail = &expired;
+        while (delays_ != nullptr && static_cast<int32_t>(now - delays_->deadline) >= 0) {
+            *tail = delays_;
+            tail = &delays_->next;
+            delays_ = delays_->next;
+        }
+        *tail = nullptr;
+
+        bool resumed = expired != nullptr;
+        while (expired != nullptr) {
+            detail::delay_waiter *next = expired->next;
+            expired->handle.resume();
+            expired = next;
+        }
+        return resumed;
+    }
+
+    bool subscribed_ = false;
+    detail::waiter<crsf_channels_t> *channels_waiters_ = nullptr;
+    detail::waiter<crsf_link_statistics_t> *link_statistics_waiters_ = nullptr;
+    detail::waiter<bool> *failsafe_waiters_ = nullptr;
+    detail::waiter<void> *telemetry_waiters_ = nullptr;
+    detail::delay_waiter *delays_ = nullptr;
+};
+
+} // namespace crsf
+
+#endif /* CRSF_CORO_HPP */
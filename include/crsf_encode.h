@@ -0,0 +1,74 @@
+#ifndef CRSF_ENCODE_H
+#define CRSF_ENCODE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "crsf_protocol.h"
+
+/*
+ * Telemetry payload encoders: convert application values to the wire format
+ * (scaled, saturated, big-endian) and write them straight into a frame
+ * buffer. Portable, shared with the host tools.
+ */
+
+#define CRSF_GPS_PAYLOAD_SIZE 15
+
+/**
+ * @brief GPS fix in SI units
+ *
+ * @param latitude_deg latitude in degrees, north positive
+ * @param longitude_deg longitude in degrees, east positive
+ * @param ground_speed_mps speed over ground in m/s
+ * @param course_deg course over ground in degrees, any value, wrapped to 0-360
+ * @param altitude_m altitude above mean sea level in m
+ * @param satellites number of satellites used in the fix
+ */
+typedef struct
+{
+    double latitude_deg;
+    double longitude_deg;
+    float ground_speed_mps;
+    float course_deg;
+    float altitude_m;
+    uint8_t satellites;
+} crsf_gps_fix_t;
+
+/**
+ * @brief encode a GPS fix as a CRSF_TYPE_GPS payload
+ *
+ * Values are rounded to the nearest wire unit (1e-7 degree, 0.1 km/h, 0.01
+ * degree, 1 m) and saturate at the limits of the wire format: +-90 and +-180
+ * degrees, 0 to 6553.5 km/h, -1000 to 64535 m. NaN encodes as 0, or as the
+ * lowest altitude.
+ *
+ * @param payload output buffer of CRSF_GPS_PAYLOAD_SIZE bytes
+ * @param fix pointer to the fix
+ * @return size_t payload length, CRSF_GPS_PAYLOAD_SIZE
+ */
+size_t crsf_encode_gps(uint8_t *payload, const crsf_gps_fix_t *fix);
+
+/**
+ * @brief encode RPM values as a CRSF_TYPE_RPM payload
+ *
+ * Values saturate at the int24 range.
+ *
+ * @param payload output buffer of 1 + 3 * count bytes
+ * @param source_id source id of the frame
+ * @param rpm RPM values, negative for reverse
+ * @param count number of values, at most CRSF_RPM_MAX_VALUES
+ * @return size_t payload length, 0 if count is 0 or too large
+ */
+size_t crsf_encode_rpm(uint8_t *payload, uint8_t source_id, const int32_t *rpm, size_t count);
+
+/**
+ * @brief encode temperatures as a CRSF_TYPE_TEMP payload
+ *
+ * @param payload output buffer of 1 + 2 * count bytes
+ * @param source_id source id of the frame
+ * @param deci_celsius temperatures in 0.1 degree Celsius
+ * @param count number of values, at most CRSF_TEMP_MAX_VALUES
+ * @return size_t payload length, 0 if count is 0 or too large
+ */
+size_t crsf_encode_temp(uint8_t *payload, uint8_t source_id, const int16_t *deci_celsius, size_t count);
+
+#endif /* CRSF_ENCODE_H */
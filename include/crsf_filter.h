@@ -0,0 +1,94 @@
+#ifndef CRSF_FILTER_H
+#define CRSF_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * RC channel smoothing in fixed point. Channels arrive as steps at the packet
+ * rate; the filter produces values at whatever rate the consumer samples it,
+ * either interpolated between the last two frames or through a first order
+ * low-pass. Coefficients are cached and only recomputed when the frame rate or
+ * the consumer's sample interval change noticeably.
+ * Portable, shared with the host tools.
+ */
+
+#define CRSF_FILTER_CHANNELS 16
+#define CRSF_FILTER_AUTO_CUTOFF_DIV 4 // automatic low-pass cutoff is the frame rate divided by this
+
+typedef enum
+{
+    CRSF_FILTER_NONE,        // latest frame, unchanged
+    CRSF_FILTER_INTERPOLATE, // linear ramp from the previous to the latest frame over one frame interval
+    CRSF_FILTER_LOWPASS      // first order low-pass evaluated at every sample
+} crsf_filter_mode_t;
+
+/**
+ * @brief filter configuration
+ *
+ * @param mode filter mode
+ * @param cutoff_hz low-pass cutoff, 0 derives it from the estimated frame rate
+ * @param channel_mask bit n set filters channel n + 1, the others are passed through (switches, modes)
+ */
+typedef struct
+{
+    crsf_filter_mode_t mode;
+    uint16_t cutoff_hz;
+    uint16_t channel_mask;
+} crsf_filter_config_t;
+
+/**
+ * @brief filter state, one per consumer
+ */
+typedef struct
+{
+    crsf_filter_config_t config;
+    bool primed;
+    uint16_t prev[CRSF_FILTER_CHANNELS];
+    uint16_t latest[CRSF_FILTER_CHANNELS];
+    int32_t state_q8[CRSF_FILTER_CHANNELS]; // low-pass output in 1/256 channel steps
+    int64_t frame_us;                       // arrival of the latest frame
+    int64_t sample_us;                      // previous crsf_filter_output call
+    // cached coefficients
+    uint32_t interval_us;     // frame interval the coefficients belong to
+    uint32_t inv_interval_q30;
+    uint16_t cutoff_hz;       // active low-pass cutoff
+    uint32_t alpha_dt_us;     // sample interval alpha_q15 was computed for
+    uint16_t alpha_q15;
+} crsf_filter_t;
+
+/**
+ * @brief reset the filter
+ *
+ * @param filter pointer to the filter state
+ * @param config pointer to the configuration
+ */
+void crsf_filter_init(crsf_filter_t *filter, const crsf_filter_config_t *config);
+
+/**
+ * @brief set the frame interval, recomputes the cached coefficients if it changed
+ *
+ * @param filter pointer to the filter state
+ * @param interval_us estimated frame interval, 0 if unknown
+ */
+void crsf_filter_set_interval(crsf_filter_t *filter, uint32_t interval_us);
+
+/**
+ * @brief feed a received channels frame
+ *
+ * @param filter pointer to the filter state
+ * @param values 16 channel values
+ * @param arrival_us arrival time of the frame
+ */
+void crsf_filter_input(crsf_filter_t *filter, const uint16_t *values, int64_t arrival_us);
+
+/**
+ * @brief sample the filter output
+ *
+ * @param filter pointer to the filter state
+ * @param now_us current time
+ * @param values receives 16 channel values
+ */
+void crsf_filter_output(crsf_filter_t *filter, int64_t now_us, uint16_t *values);
+
+#endif /* CRSF_FILTER_H */
@@ -0,0 +1,206 @@
+#ifndef CRSF_FRAME_H
+#define CRSF_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "crsf_protocol.h"
+
+/*
+ * Portable CRSF framing: CRC, stream parser and frame builder. Used by the
+ * ESP-IDF driver and by the host tools, so nothing in here may depend on
+ * FreeRTOS or the ESP-IDF drivers.
+ */
+
+typedef enum
+{
+    CRSF_CRC_FRAME,   // frame CRC, poly 0xd5
+    CRSF_CRC_COMMAND, // inner CRC of command frames, poly 0xba
+    CRSF_CRC_TABLES
+} crsf_crc_t;
+
+/**
+ * @brief fill the CRC8 lookup tables, the frame CRC with the given polynomial (CRSF uses 0xd5)
+ * and the command CRC with CRSF_COMMAND_CRC_POLY
+ *
+ * @param poly CRC8 polynomial of the frame CRC
+ */
+void generate_CRC(uint8_t poly);
+
+/**
+ * @brief fill one CRC8 lookup table
+ *
+ * @param crc table to fill
+ * @param poly CRC8 polynomial
+ */
+void crsf_crc_init(crsf_crc_t crc, uint8_t poly);
+
+/**
+ * @brief calculate the frame CRC8 checksum using the table built by generate_CRC
+ *
+ * @param data pointer to the data
+ * @param len number of bytes
+ * @return uint8_t checksum
+ */
+uint8_t crc8(const uint8_t *data, uint8_t len);
+
+/**
+ * @brief continue a CRC8 checksum with one of the tables
+ *
+ * @param crc table to use
+ * @param init checksum of the preceding data, 0 to start
+ * @param data pointer to the data
+ * @param len number of bytes
+ * @return uint8_t checksum
+ */
+uint8_t crsf_crc8(crsf_crc_t crc, uint8_t init, const uint8_t *data, size_t len);
+
+/**
+ * @brief RAM used by the CRC, 512 bytes of tables or 2 bytes without them (CONFIG_CRSF_CRC_BITWISE)
+ */
+size_t crsf_crc_memory_size(void);
+
+/**
+ * @brief view of a validated frame inside the parser buffer
+ *
+ * @param dest address byte of the frame
+ * @param type frame type
+ * @param payload_length number of payload bytes (without type and CRC)
+ * @param payload pointer to the payload, only valid inside the frame handler
+ */
+typedef struct
+{
+    uint8_t dest;
+    uint8_t type;
+    uint8_t payload_length;
+    const uint8_t *payload;
+} crsf_frame_t;
+
+typedef void (*crsf_frame_handler_t)(const crsf_frame_t *frame, void *ctx);
+
+/**
+ * @brief streaming frame parser state
+ *
+ * Bytes may be fed in arbitrary chunks. Frames with an unknown address byte,
+ * an impossible length or a bad CRC are discarded one byte at a time until the
+ * parser is back in sync.
+ *
+ * @param frames number of frames with a valid CRC
+ * @param crc_errors number of frames rejected because of a bad CRC
+ * @param dropped_bytes number of bytes discarded while resynchronising
+ */
+typedef struct
+{
+    uint8_t buf[CRSF_MAX_FRAME_SIZE];
+    uint8_t pos;
+    uint32_t frames;
+    uint32_t crc_errors;
+    uint32_t dropped_bytes;
+} crsf_parser_t;
+
+/**
+ * @brief reset parser state and statistics
+ *
+ * @param parser pointer to the parser
+ */
+void crsf_parser_init(crsf_parser_t *parser);
+
+/**
+ * @brief feed received bytes to the parser and call handler for every valid frame
+ *
+ * @param parser pointer to the parser
+ * @param data received bytes
+ * @param len number of received bytes
+ * @param handler called for each frame with a valid CRC
+ * @param ctx passed through to the handler
+ * @return size_t number of valid frames found in this chunk
+ */
+size_t crsf_parser_feed(crsf_parser_t *parser, const uint8_t *data, size_t len, crsf_frame_handler_t handler, void *ctx);
+
+/**
+ * @brief build a complete frame (address, length, type, payload, CRC)
+ *
+ * @param frame output buffer, at least payload_length + 4 bytes
+ * @param dest destination address
+ * @param type frame type
+ * @param payload payload bytes
+ * @param payload_length payload length, at most CRSF_MAX_PAYLOAD_SIZE
+ * @return size_t frame length in bytes, 0 if the payload is too long
+ */
+size_t crsf_build_frame(uint8_t *frame, uint8_t dest, uint8_t type, const void *payload, uint8_t payload_length);
+
+/**
+ * @brief complete a frame whose payload was already written to frame + 3
+ *
+ * Lets encoders write the payload in place instead of through a separate buffer.
+ *
+ * @param frame frame buffer, at least payload_length + 4 bytes
+ * @param dest destination address
+ * @param type frame type
+ * @param payload_length payload length, at most CRSF_MAX_PAYLOAD_SIZE
+ * @return size_t frame length in bytes, 0 if the payload is too long
+ */
+size_t crsf_finish_frame(uint8_t *frame, uint8_t dest, uint8_t type, uint8_t payload_length);
+
+/**
+ * @brief build a complete command frame with both CRCs
+ *
+ * @param frame output buffer, at least payload_length + 9 bytes
+ * @param dest destination address
+ * @param origin origin address
+ * @param command command id
+ * @param subcommand subcommand id
+ * @param payload command payload
+ * @param payload_length payload length, at most CRSF_COMMAND_MAX_PAYLOAD_SIZE
+ * @return size_t frame length in bytes, 0 if the payload is too long
+ */
+size_t crsf_build_command_frame(uint8_t *frame, uint8_t dest, uint8_t origin, uint8_t command, uint8_t subcommand,
+                                const void *payload, uint8_t payload_length);
+
+/**
+ * @brief check the inner CRC of a CRSF_TYPE_COMMAND frame
+ *
+ * @param frame parsed frame
+ * @return true if the frame holds a complete command header and the command CRC matches
+ */
+bool crsf_command_valid(const crsf_frame_t *frame);
+
+/**
+ * @brief unpack the 22 byte channels payload into 16 values
+ *
+ * @param payload CRSF_TYPE_CHANNELS payload
+ * @param values output array of 16 channel values
+ */
+void crsf_unpack_channels(const uint8_t *payload, uint16_t *values);
+
+/**
+ * @brief pack 16 channel values into the 22 byte channels payload
+ *
+ * @param values array of 16 channel values, only the lower 11 bits are used
+ * @param payload output buffer of CRSF_CHANNELS_PAYLOAD_SIZE bytes
+ */
+void crsf_pack_channels(const uint16_t *values, uint8_t *payload);
+
+/**
+ * @brief convert a channel value to a servo pulse width (172 -> 988 us, 992 -> 1500 us, 1811 -> 2011 us)
+ *
+ * @param value channel value
+ * @return uint16_t pulse width in microseconds
+ */
+static inline uint16_t crsf_channel_to_us(uint16_t value)
+{
+    return 1500 + ((int32_t)value - CRSF_CHANNEL_VALUE_MID) * 5 / 8;
+}
+
+/**
+ * @brief convert a servo pulse width to a channel value, inverse of crsf_channel_to_us
+ *
+ * @param us pulse width in microseconds
+ * @return uint16_t channel value
+ */
+static inline uint16_t crsf_us_to_channel(uint16_t us)
+{
+    return CRSF_CHANNEL_VALUE_MID + ((int32_t)us - 1500) * 8 / 5;
+}
+
+#endif /* CRSF_FRAME_H */
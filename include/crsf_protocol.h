@@ -0,0 +1,233 @@
+#ifndef CRSF_PROTOCOL_H
+#define CRSF_PROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * CRSF wire format definitions. This header has no ESP-IDF dependencies so the
+ * frame parser and encoders can also be built for the host tools in host/.
+ */
+
+#define CRSF_MAX_FRAME_SIZE 64   // address + length + type + payload + CRC
+#define CRSF_MAX_PAYLOAD_SIZE 60 // CRSF_MAX_FRAME_SIZE minus address, length, type and CRC
+#define CRSF_CHANNELS_PAYLOAD_SIZE 22
+
+// values per RPM (source id + int24 each) and temperature (source id + int16 each) frame
+#define CRSF_RPM_MAX_VALUES 19
+#define CRSF_TEMP_MAX_VALUES 20
+
+// not a CRSF frame type, only used by the loopback self-test: uint32 sequence number (little endian) + filler
+#define CRSF_SELFTEST_TYPE 0x7F
+#define CRSF_SELFTEST_PAYLOAD_SIZE CRSF_CHANNELS_PAYLOAD_SIZE
+
+// ELRS MAVLink envelope: chunk byte (current chunk << 4 | total chunks), data size, data
+#define CRSF_MAVLINK_CHUNK_SIZE (CRSF_MAX_PAYLOAD_SIZE - 2)
+#define CRSF_MAVLINK_MAX_CHUNKS 15
+
+// command frames: dest, origin, command, subcommand, payload, CRC8 (poly 0xba) over type .. payload
+#define CRSF_COMMAND_CRC_POLY 0xBA
+#define CRSF_COMMAND_HEADER_SIZE 4
+#define CRSF_COMMAND_MAX_PAYLOAD_SIZE (CRSF_MAX_PAYLOAD_SIZE - CRSF_COMMAND_HEADER_SIZE - 1)
+
+// channel values as sent by the transmitter (988us .. 2012us)
+#define CRSF_CHANNEL_VALUE_MIN 172
+#define CRSF_CHANNEL_VALUE_MID 992
+#define CRSF_CHANNEL_VALUE_MAX 1811
+
+/**
+ * @brief structure for handling 16 channels of data, 11 bits each. Which channel is used depends on transmitter setting
+ *
+ * @return typedef struct
+ */
+typedef struct __attribute__((packed))
+{
+    unsigned ch1 : 11;
+    unsigned ch2 : 11;
+    unsigned ch3 : 11;
+    unsigned ch4 : 11;
+    unsigned ch5 : 11;
+    unsigned ch6 : 11;
+    unsigned ch7 : 11;
+    unsigned ch8 : 11;
+    unsigned ch9 : 11;
+    unsigned ch10 : 11;
+    unsigned ch11 : 11;
+    unsigned ch12 : 11;
+    unsigned ch13 : 11;
+    unsigned ch14 : 11;
+    unsigned ch15 : 11;
+    unsigned ch16 : 11;
+} crsf_channels_t;
+
+/**
+ * @brief struct for battery data telemetry
+ *
+ * @param voltage the voltage of the battery in 10*V (1 = 0.1V)
+ * @param current the current of the battery in 10*A (1 = 0.1A)
+ * @param capacity the capacity of the battery in mah
+ * @param remaining the remaining percentage of the battery
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    unsigned voltage : 16;  // V * 10 big endian
+    unsigned current : 16;  // A * 10 big endian
+    unsigned capacity : 24; // mah big endian
+    unsigned remaining : 8; // %
+} crsf_battery_t;
+
+/**
+ * @brief struct for GPS data telemetry
+ *
+ * @param latitude int32 the latitude of the GPS in degree / 10,000,000 big endian
+ * @param longitude int32 the longitude of the GPS in degree / 10,000,000 big endian
+ * @param groundspeed uint16 the groundspeed of the GPS in km/h / 10 big endian
+ * @param heading uint16 the heading of the GPS in degree/100 big endian
+ * @param altitude uint16 the altitude of the GPS in meters, +1000m big endian
+ * @param satellites uint8 the number of satellites
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    int32_t latitude;     // degree / 10,000,000 big endian
+    int32_t longitude;    // degree / 10,000,000 big endian
+    uint16_t groundspeed; // km/h / 10 big endian
+    uint16_t heading;     // GPS heading, degree/100 big endian
+    uint16_t altitude;    // meters, +1000m big endian
+    uint8_t satellites;   // satellites
+} crsf_gps_t;
+
+typedef struct __attribute__((packed))
+{
+    uint8_t byte0;
+    uint8_t byte1;
+    uint8_t byte2;
+} int24_t;
+// Helper functions to convert between int32_t and int24_t
+static inline int32_t int24_to_int32(int24_t val)
+{
+    int32_t result = (val.byte2 << 16) | (val.byte1 << 8) | val.byte0;
+    // Sign extend if negative (bit 23 is set)
+    if (result & 0x800000)
+    {
+        result |= 0xFF000000;
+    }
+    return result;
+}
+
+static inline int24_t int32_to_int24(int32_t val)
+{
+    int24_t result;
+    result.byte0 = val & 0xFF;
+    result.byte1 = (val >> 8) & 0xFF;
+    result.byte2 = (val >> 16) & 0xFF;
+    return result;
+}
+
+/**
+ * @brief struct for RPM data telemetry
+ *
+ * @param rpm_source_id identifies the source of the RPM data (e.g., 0 = Motor 1, 1 = Motor 2, etc.)
+ * @param rpm_value array of 1 - 19 RPM values with negative ones representing the motor spinning in reverse
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    uint8_t rpm_source_id; // Identifies the source of the RPM data (e.g., 0 = Motor 1, 1 = Motor 2, etc.)
+    int24_t rpm_value[];   // 1 - 19 RPM values with negative ones representing the motor spinning in reverse
+} crsf_rpm_t;
+
+/**
+ * @brief struct for temperature data telemetry
+ *
+ * @param temp_source_id identifies the source of the temperature data (e.g., 0 = FC including all ESCs, 1 = Ambient, etc.)
+ * @param temp_value array of up to 20 temperature values in deci-degree (tenths of a degree) Celsius (e.g., 250 = 25.0°C, -50 = -5.0°C)
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    uint8_t temp_source_id; // Identifies the source of the temperature data (e.g., 0 = FC including all ESCs, 1 = Ambient, etc.)
+    int16_t temp_value[];   // up to 20 (CRSF_TEMP_MAX_VALUES) per frame, temperature values in deci-degree (tenths of a degree) Celsius (e.g., 250 = 25.0°C, -50 = -5.0°C)
+} crsf_temp_t;
+
+/**
+ * @brief struct for link statistics received from the transmitter
+ * @param up_rssi_ant1 Uplink RSSI Antenna 1 (dBm * -1)
+ * @param up_rssi_ant2 Uplink RSSI Antenna 2 (dBm * -1)
+ * @param up_link_quality Uplink Package success rate / Link quality (%)
+ * @param up_snr Uplink SNR (dB)
+ * @param active_antenna number of currently best antenna
+ * @param rf_profile enum {4fps = 0 , 50fps, 150fps}
+ * @param up_rf_power enum {0mW = 0, 10mW, 25mW, 100mW,
+ *
+ * @param down_rssi Downlink RSSI (dBm * -1)
+ * @param down_link_quality Downlink Package success rate / Link quality (%)
+ * @param down_snr Downlink SNR (dB)
+ */
+typedef struct __attribute__((packed))
+{
+    uint8_t up_rssi_ant1;    // Uplink RSSI Antenna 1 (dBm * -1)
+    uint8_t up_rssi_ant2;    // Uplink RSSI Antenna 2 (dBm * -1)
+    uint8_t up_link_quality; // Uplink Package success rate / Link quality (%)
+    int8_t up_snr;           // Uplink SNR (dB)
+    uint8_t active_antenna;  // number of currently best antenna
+    uint8_t rf_profile;      // enum {4fps = 0 , 50fps, 150fps}
+    uint8_t up_rf_power;     // enum {0mW = 0, 10mW, 25mW, 100mW,
+    uint8_t down_rssi;         // Downlink RSSI (dBm * -1)
+    uint8_t down_link_quality; // Downlink Package success rate / Link quality (%)
+    int8_t down_snr;           // Downlink SNR (dB)
+} crsf_link_statistics_t;
+
+typedef enum
+{
+    CRSF_TYPE_CHANNELS = 0x16,
+    CRSF_TYPE_BATTERY = 0x08,
+    CRSF_TYPE_GPS = 0x02,
+    CRSF_TYPE_ALTITUDE = 0x09,
+    CRSF_TYPE_ATTITUDE = 0x1E,
+    CRSF_TYPE_RPM = 0x0C,
+    CRSF_TYPE_TEMP = 0x0D,
+    CRSF_TYPE_LINK_STATISTICS = 0x14,
+    CRSF_TYPE_COMMAND = 0x32,
+    CRSF_TYPE_MAVLINK_ENVELOPE = 0xAA
+} crsf_type_t;
+
+typedef enum
+{
+    CRSF_DEST_BROADCAST = 0x00,
+    CRSF_DEST_FC = 0xC8,
+    CRSF_DEST_RADIO = 0xEA,
+    CRSF_DEST_RECEIVER = 0xEC,
+    CRSF_DEST_TRANSMITTER = 0xEE
+} crsf_dest_t;
+
+typedef enum
+{
+    CRSF_COMMAND_FC = 0x01,
+    CRSF_COMMAND_BLUETOOTH = 0x03,
+    CRSF_COMMAND_OSD = 0x05,
+    CRSF_COMMAND_VTX = 0x08,
+    CRSF_COMMAND_LED = 0x09,
+    CRSF_COMMAND_GENERAL = 0x0A,
+    CRSF_COMMAND_RX = 0x10,
+    CRSF_COMMAND_ACK = 0xFF
+} crsf_command_id_t;
+
+// subcommands of CRSF_COMMAND_RX
+#define CRSF_COMMAND_RX_BIND 0x01
+#define CRSF_COMMAND_RX_CANCEL_BIND 0x02
+#define CRSF_COMMAND_RX_SET_BIND_ID 0x03
+#define CRSF_COMMAND_RX_MODEL_SELECT 0x05
+
+/**
+ * @brief payload of a CRSF_COMMAND_ACK command, followed by an optional info string
+ */
+typedef struct __attribute__((packed))
+{
+    uint8_t command;    // acknowledged command
+    uint8_t subcommand; // acknowledged subcommand
+    uint8_t action;     // 1 if the command was executed
+} crsf_command_ack_t;
+
+#endif /* CRSF_PROTOCOL_H */
@@ -0,0 +1,76 @@
+#ifndef CRSF_RATE_H
+#define CRSF_RATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Incremental RC frame rate estimator (EWMA of the inter-arrival time in
+ * fixed point). Single lost frames and telemetry slots show up as integer
+ * multiples of the interval and do not disturb the estimate; a rate change is
+ * reported once enough consecutive intervals agree on a new value.
+ * Portable, shared with the host tools.
+ */
+
+#define CRSF_RATE_CHANGE_FRAMES 8      // consecutive intervals needed to accept a new rate
+#define CRSF_RATE_RESET_GAP_US 1000000 // longer gaps (link loss) restart the estimate
+
+/**
+ * @brief frame rate estimator state
+ *
+ * @param interval_q4 estimated interval in 1/16 us, 0 until the first interval was seen
+ * @param jitter_q4 EWMA of the absolute deviation from the estimate in 1/16 us
+ * @param candidate_q4 interval the link may have switched to
+ * @param candidate_count consecutive intervals agreeing with the candidate
+ * @param last_arrival_us arrival time of the previous frame
+ * @param rate_changes number of detected rate changes
+ */
+typedef struct
+{
+    uint32_t interval_q4;
+    uint32_t jitter_q4;
+    uint32_t candidate_q4;
+    uint8_t candidate_count;
+    int64_t last_arrival_us;
+    uint32_t rate_changes;
+} crsf_rate_estimator_t;
+
+/**
+ * @brief reset the estimator
+ *
+ * @param est pointer to the estimator
+ */
+void crsf_rate_init(crsf_rate_estimator_t *est);
+
+/**
+ * @brief feed the arrival time of an RC frame
+ *
+ * @param est pointer to the estimator
+ * @param arrival_us arrival time in microseconds
+ * @return true if this frame completed the detection of a new rate (or the first estimate)
+ */
+bool crsf_rate_update(crsf_rate_estimator_t *est, int64_t arrival_us);
+
+/**
+ * @brief estimated frame interval
+ *
+ * @param est pointer to the estimator
+ * @return uint32_t interval in microseconds, 0 if unknown
+ */
+static inline uint32_t crsf_rate_interval_us(const crsf_rate_estimator_t *est)
+{
+    return (est->interval_q4 + 8) >> 4;
+}
+
+/**
+ * @brief estimated frame rate
+ *
+ * @param est pointer to the estimator
+ * @return uint32_t rate in Hz rounded to the nearest integer, 0 if unknown
+ */
+static inline uint32_t crsf_rate_hz(const crsf_rate_estimator_t *est)
+{
+    return est->interval_q4 ? (16000000u + est->interval_q4 / 2) / est->interval_q4 : 0;
+}
+
+#endif /* CRSF_RATE_H */
@@ -0,0 +1,73 @@
+#ifndef CRSF_SBUS_H
+#define CRSF_SBUS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * SBUS framing: 100000 baud, 8E2, inverted. A frame is a 0x0F header, the 16
+ * channels packed like the CRSF channels payload (11 bits each, same value
+ * range), a flags byte and a 0x00 footer (SBUS2 receivers use 0x04, 0x14, 0x24 or
+ * 0x34). Portable, shared with the host tools.
+ */
+
+#define CRSF_SBUS_BAUD_RATE 100000
+#define CRSF_SBUS_FRAME_SIZE 25
+#define CRSF_SBUS_HEADER 0x0F
+#define CRSF_SBUS_FOOTER 0x00
+#define CRSF_SBUS_FRAME_TIME_US 3000 // 25 bytes of 12 bits at 100000 baud
+
+// flags byte
+#define CRSF_SBUS_FLAG_CH17 (1 << 0)
+#define CRSF_SBUS_FLAG_CH18 (1 << 1)
+#define CRSF_SBUS_FLAG_FRAME_LOST (1 << 2)
+#define CRSF_SBUS_FLAG_FAILSAFE (1 << 3)
+
+/**
+ * @brief build an SBUS frame
+ *
+ * @param frame output buffer of CRSF_SBUS_FRAME_SIZE bytes
+ * @param values 16 channel values
+ * @param flags CRSF_SBUS_FLAG_* bits
+ */
+void crsf_sbus_build_frame(uint8_t *frame, const uint16_t *values, uint8_t flags);
+
+typedef void (*crsf_sbus_handler_t)(const uint8_t *payload, uint8_t flags, void *ctx);
+
+/**
+ * @brief streaming SBUS parser state
+ *
+ * SBUS has no checksum, a frame is accepted when the header and footer bytes
+ * are in place. Otherwise the parser discards bytes up to the next header.
+ *
+ * @param frames number of frames accepted
+ * @param dropped_bytes number of bytes discarded while resynchronising
+ */
+typedef struct
+{
+    uint8_t buf[CRSF_SBUS_FRAME_SIZE];
+    uint8_t pos;
+    uint32_t frames;
+    uint32_t dropped_bytes;
+} crsf_sbus_parser_t;
+
+/**
+ * @brief reset parser state and statistics
+ *
+ * @param parser pointer to the parser
+ */
+void crsf_sbus_parser_init(crsf_sbus_parser_t *parser);
+
+/**
+ * @brief feed received bytes to the parser and call handler for every complete frame
+ *
+ * @param parser pointer to the parser
+ * @param data received bytes
+ * @param len number of received bytes
+ * @param handler called with the 22 byte channels payload (packed like CRSF_TYPE_CHANNELS) and the flags byte
+ * @param ctx passed through to the handler
+ * @return size_t number of frames found in this chunk
+ */
+size_t crsf_sbus_parser_feed(crsf_sbus_parser_t *parser, const uint8_t *data, size_t len, crsf_sbus_handler_t handler, void *ctx);
+
+#endif /* CRSF_SBUS_H */
@@ -0,0 +1,120 @@
+#ifndef CRSF_TXQ_H
+#define CRSF_TXQ_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "crsf_protocol.h"
+
+#if defined(ESP_PLATFORM)
+#include "sdkconfig.h"
+#endif
+
+#ifdef CONFIG_CRSF_TX_QUEUE_SLOTS
+#define CRSF_TXQ_SLOTS CONFIG_CRSF_TX_QUEUE_SLOTS
+#else
+#define CRSF_TXQ_SLOTS 8
+#endif
+
+/*
+ * Bounded lock-free multi-producer, single-consumer queue of whole frames.
+ * Producers claim a slot with a compare-and-swap on the head index and
+ * publish it through the slot sequence number (Vyukov's bounded queue), so a
+ * frame is either queued completely or not at all and a producer never waits
+ * for another one. The consumer, the UART transmit interrupt of the direct
+ * interrupt backend, takes frames from the tail in order. Portable, shared
+ * with the host tools.
+ */
+
+typedef struct
+{
+    uint32_t seq;
+    uint8_t length;
+    uint8_t frame[CRSF_MAX_FRAME_SIZE];
+} crsf_txq_slot_t;
+
+/**
+ * @brief transmit queue state
+ *
+ * @param frames frames taken by the consumer
+ * @param dropped frames dropped because the queue was full
+ * @param max_depth deepest the queue has been
+ */
+typedef struct
+{
+    crsf_txq_slot_t slots[CRSF_TXQ_SLOTS];
+    uint32_t head;
+    uint32_t tail;
+    uint32_t frames;
+    uint32_t dropped;
+    uint32_t max_depth;
+} crsf_txq_t;
+
+/**
+ * @brief reset the queue, no producer or consumer may be active
+ *
+ * @param queue pointer to the queue
+ */
+void crsf_txq_init(crsf_txq_t *queue);
+
+/**
+ * @brief queue a frame, never blocks
+ *
+ * @param queue pointer to the queue
+ * @param frame complete frame
+ * @param length frame length, at most CRSF_MAX_FRAME_SIZE
+ * @return true if the frame was queued, false if the queue was full or the frame too long
+ */
+bool crsf_txq_push(crsf_txq_t *queue, const uint8_t *frame, size_t length);
+
+/**
+ * @brief number of frames queued and not yet taken by the consumer
+ *
+ * @param queue pointer to the queue
+ * @return uint32_t frames waiting, including frames still being copied in
+ */
+static inline uint32_t crsf_txq_pending(crsf_txq_t *queue)
+{
+    return __atomic_load_n(&queue->head, __ATOMIC_RELAXED) - __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+}
+
+/*
+ * Consumer side, inline so that it ends up in the interrupt handler calling
+ * it (IRAM on ESP32). Only one consumer at a time.
+ */
+
+/**
+ * @brief look at the oldest frame without taking it
+ *
+ * @param queue pointer to the queue
+ * @param frame receives a pointer to the frame, valid until crsf_txq_pop
+ * @return size_t frame length, 0 if the queue is empty or the oldest frame is still being copied in
+ */
+static inline __attribute__((always_inline)) size_t crsf_txq_peek(crsf_txq_t *queue, const uint8_t **frame)
+{
+    uint32_t pos = queue->tail;
+    crsf_txq_slot_t *slot = &queue->slots[pos & (CRSF_TXQ_SLOTS - 1)];
+
+    if ((int32_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - (pos + 1)) < 0) {
+        return 0;
+    }
+    *frame = slot->frame;
+    return slot->length;
+}
+
+/**
+ * @brief release the frame returned by crsf_txq_peek
+ *
+ * @param queue pointer to the queue
+ */
+static inline __attribute__((always_inline)) void crsf_txq_pop(crsf_txq_t *queue)
+{
+    uint32_t pos = queue->tail;
+
+    // single consumer, plain stores instead of read-modify-write atomics
+    __atomic_store_n(&queue->slots[pos & (CRSF_TXQ_SLOTS - 1)].seq, pos + CRSF_TXQ_SLOTS, __ATOMIC_RELEASE);
+    __atomic_store_n(&queue->tail, pos + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&queue->frames, queue->frames + 1, __ATOMIC_RELAXED);
+}
+
+#endif /* CRSF_TXQ_H */
@@ -0,0 +1,20 @@
+#ifndef CRSF_ATTR_H
+#define CRSF_ATTR_H
+
+/*
+ * Placement of the receive hot path. crsf_frame.c is also built for the host
+ * tools, where these expand to nothing.
+ */
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#include "esp_attr.h"
+#endif
+
+#if defined(ESP_PLATFORM) && CONFIG_CRSF_HOT_PATH_IN_IRAM
+#define CRSF_IRAM_ATTR IRAM_ATTR
+#else
+#define CRSF_IRAM_ATTR
+#endif
+
+#endif /* CRSF_ATTR_H */
@@ -0,0 +1,138 @@
+#ifndef CRSF_INTERNAL_H
+#define CRSF_INTERNAL_H
+
+#include <stdint.h>
+#include "ESP_CRSF.h"
+#include "crsf_frame.h"
+
+/*
+ * Shared between the source files of the component, not part of the public API.
+ */
+
+#define CRSF_TAG "CRSF"
+#define CRSF_BAUD_RATE CONFIG_CRSF_BAUD_RATE
+
+/**
+ * @brief active configuration, baud_rate is never 0
+ */
+const crsf_config_t *crsf_get_config(void);
+
+/**
+ * @brief handle of rx_task, NULL before CRSF_init
+ */
+TaskHandle_t crsf_get_rx_task(void);
+
+/**
+ * @brief parser used by rx_task, for its statistics
+ */
+const crsf_parser_t *crsf_get_rx_parser(void);
+
+/**
+ * @brief add events to the subscription of the calling task, keeping the ones it already has
+ */
+esp_err_t crsf_subscribe_add(uint32_t events);
+
+/**
+ * @brief send a complete frame, see crsf_uart_write
+ *
+ * @return true if the frame was queued, false if it was dropped or the input has no return path
+ */
+bool crsf_send_frame(const uint8_t *frame, size_t length);
+
+/**
+ * @brief charge a telemetry frame to the budget and send it if the budget allows
+ *
+ * @return true if the frame was queued, false if the budget or the transmitter dropped it
+ */
+bool crsf_send_telemetry(const uint8_t *frame, size_t length, uint8_t type);
+
+// MAVLink envelope hooks, init is called from CRSF_init before rx_task starts
+void crsf_mavlink_init(void);
+void crsf_mavlink_frame(const uint8_t *payload, uint8_t payload_length);
+
+// command hooks, init and deinit are called from CRSF_init and CRSF_deinit
+void crsf_command_init(void);
+void crsf_command_deinit(void);
+void crsf_command_frame(const crsf_frame_t *frame);
+
+// self-test hook, called from rx_task for CRSF_SELFTEST_TYPE frames
+void crsf_selftest_frame(const uint8_t *payload, uint8_t payload_length);
+
+// channel history hook, called from rx_task for every channels frame
+#if CONFIG_CRSF_CHANNEL_HISTORY
+void crsf_history_push(const uint8_t *payload, int64_t arrival_us);
+#else
+static inline void crsf_history_push(const uint8_t *payload, int64_t arrival_us) {}
+#endif
+
+// latency measurement hooks, called from rx_task and the consumer APIs only while crsf_latency_active is set
+#if CONFIG_CRSF_LATENCY_MEASUREMENT
+extern volatile bool crsf_latency_active;
+
+void crsf_latency_rx_wake(int64_t now_us, size_t event_size);
+void crsf_latency_channels_published(const uint8_t *payload, int64_t parsed_us);
+void crsf_latency_rx_done(void);
+void crsf_latency_consumer_observed(void);
+#else
+// constant false lets the compiler drop the hooks from the receive path
+#define crsf_latency_active false
+
+static inline void crsf_latency_rx_wake(int64_t now_us, size_t event_size) {}
+static inline void crsf_latency_channels_published(const uint8_t *payload, int64_t parsed_us) {}
+static inline void crsf_latency_rx_done(void) {}
+static inline void crsf_latency_consumer_observed(void) {}
+#endif
+
+// low-power hook, called from rx_task for every channels frame while crsf_low_power_active is set
+#if CONFIG_CRSF_LOW_POWER
+extern volatile bool crsf_low_power_active;
+
+void crsf_low_power_frame(int64_t arrival_us, uint32_t interval_us);
+#else
+#define crsf_low_power_active false
+
+static inline void crsf_low_power_frame(int64_t arrival_us, uint32_t interval_us) {}
+#endif
+
+// output hooks, called from rx_task for every channels frame and from the failsafe timer while crsf_output_active is set
+#if CONFIG_CRSF_OUTPUT
+extern volatile bool crsf_output_active;
+
+void crsf_output_channels(const uint8_t *payload, int64_t arrival_us);
+void crsf_output_failsafe(void);
+#else
+#define crsf_output_active false
+
+static inline void crsf_output_channels(const uint8_t *payload, int64_t arrival_us) {}
+static inline void crsf_output_failsafe(void) {}
+#endif
+
+// telemetry budget hook, called from CRSF_send_payload while crsf_budget_active is set
+#if CONFIG_CRSF_TELEMETRY_BUDGET
+extern volatile bool crsf_budget_active;
+
+bool crsf_budget_take(uint8_t type, size_t length);
+// give back what crsf_budget_take charged for a frame the transmitter refused
+void crsf_budget_refund(uint8_t type, size_t length);
+#else
+#define crsf_budget_active false
+
+static inline bool crsf_budget_take(uint8_t type, size_t length) { return true; }
+static inline void crsf_budget_refund(uint8_t type, size_t length) {}
+#endif
+
+// telemetry scheduler hook, called from rx_task after every channels frame while crsf_sensor_active is set
+#if CONFIG_CRSF_SENSOR_SOURCES
+extern volatile bool crsf_sensor_active;
+
+void crsf_sensor_slot(int64_t now_us);
+// remove every source, called by CRSF_deinit once rx_task has stopped
+void crsf_sensor_deinit(void);
+#else
+#define crsf_sensor_active false
+
+static inline void crsf_sensor_slot(int64_t now_us) {}
+static inline void crsf_sensor_deinit(void) {}
+#endif
+
+#endif /* CRSF_INTERNAL_H */
@@ -0,0 +1,42 @@
+#ifndef CRSF_PPM_H
+#define CRSF_PPM_H
+
+#include <stdint.h>
+#include "ESP_CRSF.h"
+
+/*
+ * PPM input (CONFIG_CRSF_INPUT_PPM), used by rx_task instead of the UART
+ * backend when crsf_config_t.input is CRSF_INPUT_PPM. A GPIO edge interrupt
+ * measures the channel periods, rx_task only gets complete frames.
+ */
+
+/**
+ * @brief start measuring PPM frames on a pin
+ *
+ * @param rx_pin PPM input pin
+ * @return esp_err_t ESP_OK or the error of the GPIO interrupt setup
+ */
+esp_err_t crsf_ppm_start(gpio_num_t rx_pin);
+
+/**
+ * @brief remove the edge interrupt, no crsf_ppm_receive call may be blocked
+ */
+void crsf_ppm_stop(void);
+
+/**
+ * @brief block until a complete PPM frame was received
+ *
+ * Only called from rx_task.
+ *
+ * @param values output array of 16 channel values, channels missing in the frame are set to the center
+ * @param arrival_us receives the time of the edge that ended the last channel
+ * @return int number of channels in the frame, 0 after crsf_ppm_wake
+ */
+int crsf_ppm_receive(uint16_t *values, int64_t *arrival_us);
+
+/**
+ * @brief make a blocked crsf_ppm_receive return 0
+ */
+void crsf_ppm_wake(void);
+
+#endif /* CRSF_PPM_H */
@@ -0,0 +1,115 @@
+#ifndef CRSF_UART_H
+#define CRSF_UART_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ESP_CRSF.h"
+#include "crsf_txq.h"
+
+/*
+ * UART backend of the driver. Both queue transmitted frames in a lock-free
+ * frame queue (crsf_txq) with a single consumer that owns the UART TX side:
+ * crsf_uart_driver.c uses the ESP-IDF UART driver, its event queue for
+ * receiving and tx_task for transmitting, crsf_uart_isr.c
+ * (CONFIG_CRSF_UART_DIRECT_ISR) its own interrupt handler with a lock-free RX
+ * byte ring that also empties the frame queue. Exactly one of them is built.
+ */
+
+// buffer sizes of the backend, for CRSF_get_memory_report
+#define CRSF_UART_RX_RING_SIZE CONFIG_CRSF_RX_BUF_SIZE
+#define CRSF_UART_TX_RING_SIZE sizeof(crsf_txq_t) // the frame queue, there is no byte ring
+#if CONFIG_CRSF_UART_DIRECT_ISR
+#define CRSF_UART_TX_TASK_STACK_SIZE 0
+#else
+#define CRSF_UART_TX_TASK_STACK_SIZE CONFIG_CRSF_TX_TASK_STACK_SIZE
+#endif
+
+/**
+ * @brief configure the UART, route the pins and install the backend
+ *
+ * @param config configuration with a non-zero baud_rate, input CRSF_INPUT_CRSF or CRSF_INPUT_SBUS (8E2, RX inverted)
+ * @return esp_err_t ESP_OK or the error of the ESP-IDF UART functions
+ */
+esp_err_t crsf_uart_start(const crsf_config_t *config);
+
+/**
+ * @brief remove the backend, no crsf_uart_receive call may be blocked
+ */
+void crsf_uart_stop(void);
+
+/**
+ * @brief block until received bytes are available and copy them
+ *
+ * Only called from rx_task.
+ *
+ * @param data receive buffer
+ * @param max_length size of the buffer
+ * @return int number of bytes, 0 after crsf_uart_wake, -1 after an overflow dropped received bytes
+ */
+int crsf_uart_receive(uint8_t *data, size_t max_length);
+
+/**
+ * @brief make a blocked crsf_uart_receive return 0
+ */
+void crsf_uart_wake(void);
+
+/**
+ * @brief send one frame, whole or not at all
+ *
+ * Never blocks: the frame is queued for the TX interrupt or tx_task, which
+ * alone write to the UART.
+ *
+ * @param data complete frame
+ * @param length frame length, at most CRSF_MAX_FRAME_SIZE
+ * @return true if the frame was queued, false if it was dropped
+ */
+bool crsf_uart_write(const uint8_t *data, size_t length);
+
+/**
+ * @brief get the transmit statistics of the backend
+ *
+ * @param stats pointer receiving the statistics
+ */
+void crsf_uart_get_tx_stats(crsf_tx_stats_t *stats);
+
+/**
+ * @brief get the task writing to the UART
+ *
+ * @return TaskHandle_t tx_task of the UART driver backend, NULL with the direct interrupt backend or when stopped
+ */
+TaskHandle_t crsf_uart_get_tx_task(void);
+
+/**
+ * @brief RAM the running backend takes, for CRSF_get_memory_report
+ *
+ * Rings, frame queue, UART driver state and event queue as measured on the
+ * heap when it was installed, interrupt handler and the tx_task control
+ * block. The tx_task stack is not included.
+ *
+ * @return size_t bytes
+ */
+size_t crsf_uart_memory_size(void);
+
+/**
+ * @brief wait until all queued bytes are on the wire
+ *
+ * @param timeout maximum time to wait in ticks
+ */
+void crsf_uart_wait_tx_done(TickType_t timeout);
+
+/**
+ * @brief discard received bytes that were not read yet
+ */
+void crsf_uart_flush_input(void);
+
+/**
+ * @brief change the baud rate while running
+ */
+esp_err_t crsf_uart_set_baudrate(uint32_t baud_rate);
+
+/**
+ * @brief change the pins while running
+ */
+esp_err_t crsf_uart_set_pins(uint8_t tx_pin, uint8_t rx_pin);
+
+#endif /* CRSF_UART_H */